@@ -0,0 +1,106 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2023 - present Mikael Sundell.
+//
+
+#include "arena.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+namespace {
+
+// arenas are registered for stats, counts of destroyed arenas are kept
+std::mutex mutex;
+std::vector<const Arena*> arenas;
+ArenaStats retired;
+std::atomic<size_t> heap { 0 };
+thread_local Arena* current = nullptr;
+
+}
+
+Arena::Arena(size_t chunksize)
+: chunksize(chunksize)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    arenas.push_back(this);
+}
+
+Arena::~Arena()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    arenas.erase(std::find(arenas.begin(), arenas.end(), this));
+    retired.allocations += allocations;
+    retired.bytes += bytes;
+    retired.chunks += chunks.size();
+    retired.resets += resets;
+}
+
+void* Arena::allocate(size_t size, size_t alignment)
+{
+    allocations++;
+    bytes += size;
+    while (true) {
+        if (chunk == chunks.size()) {
+            // large allocations get a chunk of their own
+            Chunk next;
+            next.size = std::max(chunksize, size + alignment);
+            next.data.reset(new char[next.size]);
+            chunks.push_back(std::move(next));
+            offset = 0;
+        }
+        Chunk& block = chunks[chunk];
+        uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+        size_t aligned = ((base + offset + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+        if (aligned + size <= block.size) {
+            offset = aligned + size;
+            return block.data.get() + aligned;
+        }
+        chunk++;
+        offset = 0;
+    }
+}
+
+void Arena::reset()
+{
+    chunk = 0;
+    offset = 0;
+    resets++;
+}
+
+ArenaStats arenaStats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    ArenaStats stats = retired;
+    for (const Arena* arena : arenas) {
+        stats.allocations += arena->allocations;
+        stats.bytes += arena->bytes;
+        stats.chunks += arena->chunks.size();
+        stats.resets += arena->resets;
+    }
+    stats.heap = heap.load(std::memory_order_relaxed);
+    return stats;
+}
+
+Arena* arenaBy()
+{
+    return current;
+}
+
+ArenaScope::ArenaScope(Arena* arena)
+: previous(current)
+{
+    current = arena;
+}
+
+ArenaScope::~ArenaScope()
+{
+    current = previous;
+}
+
+void arenaHeapAllocation()
+{
+    heap.fetch_add(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,135 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2023 - present Mikael Sundell.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// allocations of all arenas since start, heap counts allocations made by
+// arena allocators while no arena was installed
+struct ArenaStats
+{
+    size_t allocations = 0;
+    size_t bytes = 0;
+    size_t chunks = 0;
+    size_t resets = 0;
+    size_t heap = 0;
+};
+
+ArenaStats arenaStats();
+
+// bump allocator for the transient structures of one job, memory is handed
+// out from chunks and never freed one by one. reset rewinds to the first
+// chunk in O(1) and keeps the chunks for the next job. an arena is used by
+// one thread at a time.
+class Arena
+{
+public:
+    explicit Arena(size_t chunksize = 64 * 1024);
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    ~Arena();
+
+    void* allocate(size_t bytes, size_t alignment);
+    void reset();
+
+private:
+    friend ArenaStats arenaStats();
+    struct Chunk
+    {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+    std::vector<Chunk> chunks;
+    size_t chunksize;
+    size_t chunk = 0;
+    size_t offset = 0;
+    size_t allocations = 0;
+    size_t bytes = 0;
+    size_t resets = 0;
+};
+
+// arena of the calling thread, null when allocations go to the heap
+Arena* arenaBy();
+
+// installs an arena on the calling thread until destruction
+class ArenaScope
+{
+public:
+    explicit ArenaScope(Arena* arena);
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+    ~ArenaScope();
+
+private:
+    Arena* previous;
+};
+
+// counts an allocation that fell back to the heap
+void arenaHeapAllocation();
+
+// allocator of the arena installed when the container is constructed,
+// copies take the arena of the copying thread and moves keep their arena
+template <typename T>
+class ArenaAllocator
+{
+public:
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    ArenaAllocator() noexcept
+    : arena(arenaBy())
+    {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept
+    : arena(other.arena)
+    {}
+
+    T* allocate(size_t n)
+    {
+        if (arena) {
+            return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+        }
+        arenaHeapAllocation();
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* p, size_t n) noexcept
+    {
+        if (!arena) {
+            std::allocator<T>().deallocate(p, n);
+        }
+    }
+
+    ArenaAllocator select_on_container_copy_construction() const
+    {
+        return ArenaAllocator();
+    }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const
+    {
+        return arena == other.arena;
+    }
+
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const
+    {
+        return arena != other.arena;
+    }
+
+    Arena* arena;
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+typedef std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>> ArenaString;
@@ -0,0 +1,1129 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2023 - present Mikael Sundell.
+//
+
+#include "displaylist.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <cstdio>
+#include <limits>
+#include <mutex>
+#include <type_traits>
+
+#ifdef _WIN32
+#    define WIN32_LEAN_AND_MEAN
+#    define NOMINMAX
+#    include <windows.h>
+#else
+#    include <dlfcn.h>
+#endif
+
+// imath
+#include <Imath/ImathBox.h>
+#include <Imath/half.h>
+
+// openimageio
+#include <OpenImageIO/filesystem.h>
+#include <OpenImageIO/imagebuf.h>
+#include <OpenImageIO/parallel.h>
+
+// symmetrytool
+#include "trace.h"
+
+using namespace OIIO;
+
+// kernels, runs of a row or column blended over in the pixel type. channels
+// and conversions are resolved at compile time, the kernel is chosen once
+// per display list and no pixel branches on the format
+typedef void (*SpanKernel)(ImageBuf& imagebuf, int x, int y, int length, bool vertical, const Imath::Vec4<float>& color);
+
+template <typename T, int Channels>
+void renderSpan(ImageBuf& imagebuf, int x, int y, int length, bool vertical, const Imath::Vec4<float>& color)
+{
+    // the same blend as render_line, the associated color over by alpha and
+    // written as is without an alpha channel
+    float t = Channels == 3 ? 0.0f : 1.0f - color.w;
+    char* pixel = (char*)imagebuf.pixeladdr(x, y);
+    stride_t step = vertical ? imagebuf.scanline_stride() : imagebuf.pixel_stride();
+    for (int i = 0; i < length; i++, pixel += step) {
+        T* p = (T*)pixel;
+        for (int c = 0; c < Channels; c++) {
+            if constexpr (std::is_same<T, float>::value) {
+                p[c] = color[c] + p[c] * t;
+            } else if constexpr (std::is_same<T, half>::value) {
+                p[c] = half(color[c] + (float)p[c] * t);
+            } else {
+                constexpr float max = (float)std::numeric_limits<T>::max();
+                float v = (color[c] + p[c] * (1.0f / max) * t) * max + 0.5f;
+                p[c] = (T)std::min(std::max(v, 0.0f), max);
+            }
+        }
+    }
+}
+
+SpanKernel kernelBy(ImageBuf& imagebuf)
+{
+    // by pixel type and channels, other formats and buffers not in memory
+    // are drawn by render_line
+    static const SpanKernel kernels[4][3] = {
+        { renderSpan<uint8_t, 1>, renderSpan<uint8_t, 3>, renderSpan<uint8_t, 4> },
+        { renderSpan<uint16_t, 1>, renderSpan<uint16_t, 3>, renderSpan<uint16_t, 4> },
+        { renderSpan<half, 1>, renderSpan<half, 3>, renderSpan<half, 4> },
+        { renderSpan<float, 1>, renderSpan<float, 3>, renderSpan<float, 4> }
+    };
+    const ImageSpec& spec = imagebuf.spec();
+    if (!imagebuf.localpixels() || spec.channelformats.size()) {
+        return nullptr;
+    }
+    int type = -1;
+    switch (spec.format.basetype) {
+        case TypeDesc::UINT8: type = 0; break;
+        case TypeDesc::UINT16: type = 1; break;
+        case TypeDesc::HALF: type = 2; break;
+        case TypeDesc::FLOAT: type = 3; break;
+        default: return nullptr;
+    }
+    switch (spec.nchannels) {
+        case 1: return kernels[type][0];
+        case 3: return kernels[type][1];
+        case 4: return kernels[type][2];
+        default: return nullptr;
+    }
+}
+
+// utils, colors are associated, premultiplied by their alpha and blended over
+void renderBoxByThickness(ImageBuf& imagebuf, ROI roi, Imath::Vec4<float> color, int thickness, ROI clip = ROI()) {
+
+    for (int t=0; t<thickness; t++) {
+        ImageBufAlgo::render_box(
+            imagebuf, roi.xbegin + t, roi.ybegin + t, roi.xend - t - 1, roi.yend - t - 1,
+            { color.x, color.y, color.z, color.w }, false, clip
+        );
+        if (t > 0) {
+            ImageBufAlgo::render_box(
+                imagebuf, roi.xbegin - t, roi.ybegin - t, roi.xend + t - 1, roi.yend + t - 1,
+                { color.x, color.y, color.z, color.w }, false, clip
+            );
+        }
+    }
+}
+
+void renderLineBySubpixel(ImageBuf& imagebuf, Imath::Vec2<float> begin, Imath::Vec2<float> end, Imath::Vec4<float> color, int thickness, ROI clip = ROI(), SpanKernel kernel = nullptr) {
+
+    // pixels are sampled at their centers along the major axis from float
+    // endpoints, runs on the same row or column are drawn as one line.
+    // thick lines are parallel runs offset along the minor axis, pixels
+    // never overlap
+    bool shallow = std::abs(end.x - begin.x) >= std::abs(end.y - begin.y);
+    if (!shallow) {
+        std::swap(begin.x, begin.y);
+        std::swap(end.x, end.y);
+    }
+    if (begin.x > end.x) {
+        std::swap(begin, end);
+    }
+    float slope = end.x > begin.x ? (end.y - begin.y) / (end.x - begin.x) : 0.0f;
+    int first = std::ceil(begin.x - 0.5f);
+    int last = std::floor(end.x - 0.5f);
+    if (first > last) {
+        // shorter than a pixel, the pixel of the midpoint
+        first = last = std::floor((begin.x + end.x) / 2);
+    }
+    if (clip.defined()) {
+        first = std::max(first, shallow ? clip.xbegin : clip.ybegin);
+        last = std::min(last, (shallow ? clip.xend : clip.yend) - 1);
+    }
+    ROI bounds = clip.defined() ? roi_intersection(clip, imagebuf.roi()) : imagebuf.roi();
+    auto minorBy = [&](int major) {
+        float minor = begin.y + (major + 0.5f - begin.x) * slope;
+        return (int)std::floor(std::min(std::max(minor, std::min(begin.y, end.y)), std::max(begin.y, end.y)));
+    };
+    int runbegin = first;
+    int runminor = minorBy(first);
+    for (int major = first; major <= last; major++) {
+        int minor = major < last ? minorBy(major + 1) : runminor;
+        if (major == last || minor != runminor) {
+            for (int t = -(thickness - 1) / 2; t <= thickness / 2; t++) {
+                if (kernel) {
+                    // runs clipped to the bounds, render_line clips by pixel
+                    int x = shallow ? std::max(runbegin, bounds.xbegin) : runminor + t;
+                    int y = shallow ? runminor + t : std::max(runbegin, bounds.ybegin);
+                    int stop = shallow ? std::min(major, bounds.xend - 1) : std::min(major, bounds.yend - 1);
+                    int length = stop - (shallow ? x : y) + 1;
+                    if (length > 0 && x >= bounds.xbegin && x < bounds.xend && y >= bounds.ybegin && y < bounds.yend) {
+                        kernel(imagebuf, x, y, length, !shallow, color);
+                    }
+                    continue;
+                }
+                ImageBufAlgo::render_line(
+                    imagebuf,
+                    shallow ? runbegin : runminor + t,
+                    shallow ? runminor + t : runbegin,
+                    shallow ? major : runminor + t,
+                    shallow ? runminor + t : major,
+                    { color.x, color.y, color.z, color.w },
+                    false,
+                    clip
+                );
+            }
+            runbegin = major + 1;
+            runminor = minor;
+        }
+    }
+}
+
+void renderLineByPattern(ImageBuf& imagebuf, Imath::Vec2<float> begin, Imath::Vec2<float> end, Imath::Vec4<float> color, int dot_interval, int thickness = 1, ROI clip = ROI(), SpanKernel kernel = nullptr) {
+
+    Imath::Vec2<float> d = end - begin;
+    float length = std::sqrt(d.x * d.x + d.y * d.y);
+    int dots = std::round(length / dot_interval);
+    for (int i = 0; i < dots; ++i) {
+        if (i % 2 == 0) {
+            float start = static_cast<float>(i) / dots;
+            float stop = static_cast<float>(i + 1) / dots;
+            renderLineBySubpixel(imagebuf, begin + d * start, begin + d * stop, color, thickness, clip, kernel);
+        }
+    }
+}
+
+// utils -- region of interest
+Imath::Box2f scaleBy(const Imath::Box2f& box, float sx, float sy)
+{
+    Imath::Vec2<float> center = box.center();
+    Imath::Vec2<float> size = box.size();
+    Imath::Vec2<float> ssize(size.x * sx / 2, size.y * sy / 2);
+    return Imath::Box2f(center - ssize, center + ssize);
+}
+
+Imath::Box2f aspectRatioBy(const Imath::Box2f& box, float aspectRatio)
+{
+    // width is kept, height is set by aspect ratio around the center
+    Imath::Vec2<float> center = box.center();
+    Imath::Vec2<float> size = box.size();
+    float height = size.x / aspectRatio;
+    return Imath::Box2f(
+        Imath::Vec2<float>(box.min.x, center.y - height / 2),
+        Imath::Vec2<float>(box.max.x, center.y + height / 2)
+    );
+}
+
+// utils -- trigonometry
+float radiansBy90()
+{
+    return M_PI / 2.0;
+}
+
+float degreesByRadians(float radians)
+{
+    return radians * 180.0f / M_PI;
+}
+
+// utils -- st map
+std::shared_ptr<const STMap> stmapBy(const std::string& filename)
+{
+    // st maps are read once and shared by frames and jobs
+    static std::mutex mutex;
+    static std::map<std::string, std::shared_ptr<const STMap>> stmaps;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = stmaps.find(filename);
+    if (it != stmaps.end()) {
+        return it->second;
+    }
+    std::shared_ptr<STMap> stmap;
+    ImageBuf imagebuf(filename);
+    if (imagebuf.read(0, 0, true, TypeDesc::FLOAT) && imagebuf.nchannels() >= 2) {
+        const ImageSpec& spec = imagebuf.spec();
+        stmap = std::make_shared<STMap>();
+        stmap->width = spec.width;
+        stmap->height = spec.height;
+        stmap->st.resize((size_t)spec.width * spec.height * 2);
+        ROI roi = imagebuf.roi();
+        roi.chbegin = 0;
+        roi.chend = 2;
+        imagebuf.get_pixels(roi, TypeDesc::FLOAT, stmap->st.data());
+    }
+    stmaps[filename] = stmap;
+    return stmap;
+}
+
+Imath::Vec2<float> warpBy(const STMap& stmap, Imath::Vec2<float> point, int width, int height)
+{
+    // st maps distorted pixels to undistorted st with t up, the distorted
+    // position of an undistorted point is solved by newton iteration with
+    // a finite difference jacobian starting at the point itself
+    Imath::Vec2<float> scale((float)stmap.width / width, (float)stmap.height / height);
+    auto undistort = [&](Imath::Vec2<float> p) {
+        Imath::Vec2<float> st = stmap.sample(p.x * scale.x, p.y * scale.y);
+        return Imath::Vec2<float>(st.x * width, (1.0f - st.y) * height);
+    };
+    Imath::Vec2<float> q = point;
+    for (int i = 0; i < 16; i++) {
+        Imath::Vec2<float> f = undistort(q) - point;
+        if (std::abs(f.x) < 0.01f && std::abs(f.y) < 0.01f) {
+            break;
+        }
+        Imath::Vec2<float> dx = undistort(Imath::Vec2<float>(q.x + 1.0f, q.y)) - undistort(q);
+        Imath::Vec2<float> dy = undistort(Imath::Vec2<float>(q.x, q.y + 1.0f)) - undistort(q);
+        float det = dx.x * dy.y - dy.x * dx.y;
+        if (std::abs(det) < 1e-6f) {
+            break;
+        }
+        q.x -= (dy.y * f.x - dy.x * f.y) / det;
+        q.y -= (dx.x * f.y - dx.y * f.x) / det;
+    }
+    return q;
+}
+
+// display list
+void addBox(DisplayList& displaylist, const Imath::Box2f& box, Imath::Vec3<float> color, int thickness)
+{
+    Primitive primitive;
+    primitive.type = PrimitiveType::Box;
+    primitive.begin = box.min;
+    primitive.end = box.max;
+    primitive.color = color;
+    primitive.thickness = thickness;
+    displaylist.push_back(primitive);
+}
+
+void addLine(DisplayList& displaylist, float xbegin, float ybegin, float xend, float yend, Imath::Vec3<float> color)
+{
+    Primitive primitive;
+    primitive.type = PrimitiveType::Line;
+    primitive.begin = Imath::Vec2<float>(xbegin, ybegin);
+    primitive.end = Imath::Vec2<float>(xend, yend);
+    primitive.color = color;
+    displaylist.push_back(primitive);
+}
+
+void addPattern(DisplayList& displaylist, float xbegin, float ybegin, float xend, float yend, Imath::Vec3<float> color, int interval)
+{
+    Primitive primitive;
+    primitive.type = PrimitiveType::Pattern;
+    primitive.begin = Imath::Vec2<float>(xbegin, ybegin);
+    primitive.end = Imath::Vec2<float>(xend, yend);
+    primitive.color = color;
+    primitive.interval = interval;
+    displaylist.push_back(primitive);
+}
+
+void addText(DisplayList& displaylist, float x, float y, const char* text, const char* font, ImageBufAlgo::TextAlignY aligny, Imath::Vec3<float> color)
+{
+    Primitive primitive;
+    primitive.type = PrimitiveType::Text;
+    primitive.begin = Imath::Vec2<float>(x, y);
+    primitive.end = primitive.begin;
+    primitive.color = color;
+    primitive.text = text;
+    primitive.font = font;
+    primitive.aligny = aligny;
+    displaylist.push_back(primitive);
+}
+
+// utils -- style
+void styleBy(DisplayList& displaylist, size_t first, const std::string& name, const SymmetryTool& symmetrytool)
+{
+    auto it = symmetrytool.styles.find(name);
+    if (it == symmetrytool.styles.end()) {
+        return;
+    }
+    // primitives added from first on are of the style class, boxes are
+    // dashed by edges when compacted
+    const SymmetryStyle& style = it->second;
+    for (size_t i = first; i < displaylist.size(); i++) {
+        Primitive& primitive = displaylist[i];
+        if (style.hascolor) {
+            primitive.color = style.color;
+        }
+        primitive.opacity = style.opacity;
+        if (primitive.type == PrimitiveType::Text) {
+            continue;
+        }
+        if (style.thickness > 0) {
+            primitive.thickness = style.thickness;
+        }
+        if (style.dash >= 0) {
+            if (primitive.type != PrimitiveType::Box) {
+                primitive.type = style.dash > 0 ? PrimitiveType::Pattern : PrimitiveType::Line;
+            }
+            primitive.interval = style.dash;
+        }
+    }
+}
+
+// utils -- raster
+ROI roiBy(const Primitive& primitive)
+{
+    return ROI(
+        std::round(primitive.begin.x),
+        std::round(primitive.end.x),
+        std::round(primitive.begin.y),
+        std::round(primitive.end.y)
+    );
+}
+
+// utils -- bounds
+ROI boundsBy(const Primitive& primitive)
+{
+    switch (primitive.type) {
+        case PrimitiveType::Box: {
+            ROI roi = roiBy(primitive);
+            int t = primitive.thickness;
+            return ROI(roi.xbegin - t, roi.xend + t, roi.ybegin - t, roi.yend + t);
+        }
+        case PrimitiveType::Text: {
+            // conservative, alignment may place the text on any side
+            int x = std::round(primitive.begin.x);
+            int y = std::round(primitive.begin.y);
+            ROI size = ImageBufAlgo::text_size(string_view(primitive.text.data(), primitive.text.size()), primitive.fontsize, string_view(primitive.font.data(), primitive.font.size()));
+            int w = size.defined() ? size.width() : primitive.fontsize * (int)primitive.text.size();
+            int h = size.defined() ? size.height() : primitive.fontsize;
+            return ROI(x - w, x + w + 1, y - h, y + h + 1);
+        }
+        default: {
+            // sampled pixels lie within the pixels of the endpoints
+            int t = primitive.thickness / 2;
+            return ROI(
+                std::floor(std::min(primitive.begin.x, primitive.end.x)) - t,
+                std::floor(std::max(primitive.begin.x, primitive.end.x)) + t + 1,
+                std::floor(std::min(primitive.begin.y, primitive.end.y)) - t,
+                std::floor(std::max(primitive.begin.y, primitive.end.y)) + t + 1
+            );
+        }
+    }
+}
+
+bool intersects(const ROI& a, const ROI& b)
+{
+    return a.xbegin < b.xend && b.xbegin < a.xend &&
+           a.ybegin < b.yend && b.ybegin < a.yend;
+}
+
+// utils -- render
+void renderPrimitive(ImageBuf& imagebuf, const Primitive& primitive, ROI clip = ROI(), SpanKernel kernel = nullptr)
+{
+    // lines and boxes are blended over as associated colors, text is given
+    // the unassociated color and premultiplied by render_text
+    float opacity = primitive.opacity;
+    Imath::Vec4<float> text(primitive.color.x, primitive.color.y, primitive.color.z, opacity);
+    Imath::Vec4<float> color(primitive.color.x * opacity, primitive.color.y * opacity, primitive.color.z * opacity, opacity);
+    if (imagebuf.nchannels() == 1) {
+        // coverage, the single channel is alpha
+        text = color = Imath::Vec4<float>(opacity, opacity, opacity, opacity);
+    }
+    switch (primitive.type) {
+        case PrimitiveType::Box: {
+            renderBoxByThickness(imagebuf, roiBy(primitive), color, primitive.thickness, clip);
+            break;
+        }
+        case PrimitiveType::Line: {
+            renderLineBySubpixel(imagebuf, primitive.begin, primitive.end, color, primitive.thickness, clip, kernel);
+            break;
+        }
+        case PrimitiveType::Pattern: {
+            renderLineByPattern(imagebuf, primitive.begin, primitive.end, color, primitive.interval, primitive.thickness, clip, kernel);
+            break;
+        }
+        case PrimitiveType::Text: {
+            TraceSpan span("render_text", "render");
+            ImageBufAlgo::render_text(
+                imagebuf,
+                std::round(primitive.begin.x),
+                std::round(primitive.begin.y),
+                string_view(primitive.text.data(), primitive.text.size()),
+                primitive.fontsize,
+                string_view(primitive.font.data(), primitive.font.size()),
+                { text.x, text.y, text.z, text.w },
+                ImageBufAlgo::TextAlignX::Left,
+                primitive.aligny,
+                0,
+                clip
+            );
+            break;
+        }
+    }
+}
+
+const char* nameByType(PrimitiveType type)
+{
+    switch (type) {
+        case PrimitiveType::Box: return "render_box";
+        case PrimitiveType::Line: return "render_line";
+        case PrimitiveType::Pattern: return "render_pattern";
+        case PrimitiveType::Text: return "text";
+    }
+    return "render";
+}
+
+DisplayBounds boundsBy(const DisplayList& displaylist)
+{
+    DisplayBounds bounds;
+    bounds.reserve(displaylist.size());
+    for (const Primitive& primitive : displaylist) {
+        bounds.push_back(boundsBy(primitive));
+    }
+    return bounds;
+}
+
+void renderDisplayList(ImageBuf& imagebuf, const DisplayList& displaylist, ROI clip)
+{
+    // bounds are only needed to clip
+    renderDisplayList(imagebuf, displaylist, clip.defined() ? boundsBy(displaylist) : DisplayBounds(), clip);
+}
+
+void renderDisplayList(ImageBuf& imagebuf, const DisplayList& displaylist, const DisplayBounds& bounds, ROI clip)
+{
+    // batches of primitives of the same type are traced as one span
+    SpanKernel kernel = kernelBy(imagebuf);
+    for (size_t i = 0; i < displaylist.size();) {
+        size_t end = i;
+        while (end < displaylist.size() && displaylist[end].type == displaylist[i].type) {
+            end++;
+        }
+        TraceSpan span(nameByType(displaylist[i].type), "render");
+        for (; i < end; i++) {
+            const Primitive& primitive = displaylist[i];
+            if (!clip.defined() || intersects(bounds[i], clip)) {
+                renderPrimitive(imagebuf, primitive, clip, kernel);
+            }
+        }
+    }
+}
+
+// utils -- compact
+void compactDisplayList(DisplayList& displaylist)
+{
+    // boxes as edge lines through pixel centers, each ring drawn like
+    // render_box with the first point of each edge skipped so corners are
+    // drawn once
+    DisplayList lines;
+    for (const Primitive& primitive : displaylist) {
+        if (primitive.type != PrimitiveType::Box) {
+            lines.push_back(primitive);
+            continue;
+        }
+        auto edge = [&](int xbegin, int ybegin, int xend, int yend) {
+            Primitive line = primitive;
+            line.type = primitive.interval > 0 ? PrimitiveType::Pattern : PrimitiveType::Line;
+            line.begin = Imath::Vec2<float>(xbegin + 0.5f, ybegin + 0.5f);
+            line.end = Imath::Vec2<float>(xend + 0.5f, yend + 0.5f);
+            line.thickness = 1;
+            lines.push_back(line);
+        };
+        ROI roi = roiBy(primitive);
+        for (int t = 0; t < primitive.thickness; t++) {
+            ArenaVector<ROI> rings;
+            rings.push_back(ROI(roi.xbegin + t, roi.xend - t - 1, roi.ybegin + t, roi.yend - t - 1));
+            if (t > 0) {
+                rings.push_back(ROI(roi.xbegin - t, roi.xend + t - 1, roi.ybegin - t, roi.yend + t - 1));
+            }
+            for (const ROI& ring : rings) {
+                int x1 = ring.xbegin, x2 = ring.xend, y1 = ring.ybegin, y2 = ring.yend;
+                edge(std::min(x1 + 1, x2), y1, x2, y1);
+                edge(x2, std::min(y1 + 1, y2), x2, y2);
+                edge(std::max(x2 - 1, x1), y2, x1, y2);
+                edge(x1, std::max(y2 - 1, y1), x1, y1);
+            }
+        }
+    }
+    
+    // later primitives are drawn on top, walking backwards the pixels of
+    // horizontal and vertical lines already covered on their row or column
+    // are removed and repeated lines or patterns are dropped. only opaque
+    // single pixel lines cover, translucent pixels are blended over
+    typedef std::pair<int, int> Span;
+    typedef std::pair<bool, int> Key;
+    std::map<Key, ArenaVector<Span>, std::less<Key>, ArenaAllocator<std::pair<const Key, ArenaVector<Span>>>> covered;
+    DisplayList compact;
+    for (auto it = lines.rbegin(); it != lines.rend(); ++it) {
+        const Primitive& primitive = *it;
+        bool horizontal = primitive.begin.y == primitive.end.y;
+        bool vertical = primitive.begin.x == primitive.end.x;
+        bool opaque = primitive.opacity >= 1.0f && primitive.thickness == 1;
+        
+        // pixels sampled at centers along the line
+        float major = horizontal ? primitive.begin.y : primitive.begin.x;
+        float first = horizontal ? std::min(primitive.begin.x, primitive.end.x) : std::min(primitive.begin.y, primitive.end.y);
+        float last = horizontal ? std::max(primitive.begin.x, primitive.end.x) : std::max(primitive.begin.y, primitive.end.y);
+        Span span(std::ceil(first - 0.5f), std::floor(last - 0.5f));
+        
+        if (primitive.type == PrimitiveType::Line && primitive.thickness == 1 && (horizontal || vertical) && span.first <= span.second) {
+            Key key(horizontal, std::floor(major));
+            ArenaVector<Span> pieces(1, span);
+            for (const Span& cover : covered[key]) {
+                ArenaVector<Span> remaining;
+                for (const Span& piece : pieces) {
+                    if (cover.second < piece.first || cover.first > piece.second) {
+                        remaining.push_back(piece);
+                        continue;
+                    }
+                    if (piece.first < cover.first) {
+                        remaining.push_back(Span(piece.first, cover.first - 1));
+                    }
+                    if (piece.second > cover.second) {
+                        remaining.push_back(Span(cover.second + 1, piece.second));
+                    }
+                }
+                pieces = std::move(remaining);
+            }
+            for (const Span& piece : pieces) {
+                Primitive line = primitive;
+                if (horizontal) {
+                    line.begin = Imath::Vec2<float>(piece.first + 0.5f, major);
+                    line.end = Imath::Vec2<float>(piece.second + 0.5f, major);
+                } else {
+                    line.begin = Imath::Vec2<float>(major, piece.first + 0.5f);
+                    line.end = Imath::Vec2<float>(major, piece.second + 0.5f);
+                }
+                compact.push_back(line);
+            }
+            if (opaque) {
+                covered[key].push_back(span);
+            }
+        } else if (primitive.type == PrimitiveType::Text) {
+            compact.push_back(primitive);
+        } else {
+            bool repeated = std::any_of(compact.begin(), compact.end(), [&](const Primitive& other) {
+                return other.type == primitive.type && other.begin == primitive.begin && other.end == primitive.end &&
+                       other.interval == primitive.interval && other.thickness == primitive.thickness && other.opacity >= 1.0f;
+            });
+            if (!repeated) {
+                compact.push_back(primitive);
+            }
+        }
+    }
+    std::reverse(compact.begin(), compact.end());
+    displaylist = std::move(compact);
+}
+
+// utils -- warp
+void warpSegment(
+    const STMap& stmap,
+    Imath::Vec2<float> a,
+    Imath::Vec2<float> b,
+    Imath::Vec2<float> wa,
+    Imath::Vec2<float> wb,
+    int width,
+    int height,
+    int depth,
+    ArenaVector<Imath::Vec2<float>>& points
+)
+{
+    // halved until the warped midpoint is within a quarter pixel of the
+    // warped chord, cost follows line length and curvature
+    Imath::Vec2<float> m = (a + b) * 0.5f;
+    Imath::Vec2<float> wm = warpBy(stmap, m, width, height);
+    Imath::Vec2<float> chord = (wa + wb) * 0.5f - wm;
+    if (depth < 12 && chord.length2() > 0.25f * 0.25f) {
+        warpSegment(stmap, a, m, wa, wm, width, height, depth + 1, points);
+        warpSegment(stmap, m, b, wm, wb, width, height, depth + 1, points);
+    } else {
+        points.push_back(wb);
+    }
+}
+
+void warpDisplayList(DisplayList& displaylist, const STMap& stmap, int width, int height)
+{
+    // patterns are split into dashes and each line is adaptively subdivided
+    // into warped lines, text is moved by its anchor
+    DisplayList lines;
+    for (const Primitive& primitive : displaylist) {
+        if (primitive.type == PrimitiveType::Pattern) {
+            Imath::Vec2<float> d = primitive.end - primitive.begin;
+            float length = std::sqrt(d.length2());
+            int dots = std::round(length / primitive.interval);
+            for (int i = 0; i < dots; i += 2) {
+                Primitive line = primitive;
+                line.type = PrimitiveType::Line;
+                line.begin = primitive.begin + d * ((float)i / dots);
+                line.end = primitive.begin + d * ((float)(i + 1) / dots);
+                lines.push_back(line);
+            }
+        } else {
+            lines.push_back(primitive);
+        }
+    }
+    DisplayList warped;
+    for (const Primitive& primitive : lines) {
+        if (primitive.type == PrimitiveType::Line) {
+            Imath::Vec2<float> wa = warpBy(stmap, primitive.begin, width, height);
+            Imath::Vec2<float> wb = warpBy(stmap, primitive.end, width, height);
+            ArenaVector<Imath::Vec2<float>> points(1, wa);
+            warpSegment(stmap, primitive.begin, primitive.end, wa, wb, width, height, 0, points);
+            for (size_t i = 1; i < points.size(); i++) {
+                Primitive line = primitive;
+                line.begin = points[i - 1];
+                line.end = points[i];
+                warped.push_back(line);
+            }
+        } else {
+            Primitive other = primitive;
+            other.begin = warpBy(stmap, primitive.begin, width, height);
+            other.end = other.begin;
+            warped.push_back(other);
+        }
+    }
+    displaylist = std::move(warped);
+}
+
+// utils -- dirty tiles
+ArenaVector<ROI> regionsBy(const Primitive& primitive)
+{
+    ArenaVector<ROI> regions;
+    switch (primitive.type) {
+        case PrimitiveType::Box: {
+            // outline edges only, the interior is not touched
+            ROI roi = roiBy(primitive);
+            int t = primitive.thickness;
+            regions.push_back(ROI(roi.xbegin - t, roi.xend + t, roi.ybegin - t, roi.ybegin + t));
+            regions.push_back(ROI(roi.xbegin - t, roi.xend + t, roi.yend - t, roi.yend + t));
+            regions.push_back(ROI(roi.xbegin - t, roi.xbegin + t, roi.ybegin - t, roi.yend + t));
+            regions.push_back(ROI(roi.xend - t, roi.xend + t, roi.ybegin - t, roi.yend + t));
+            break;
+        }
+        case PrimitiveType::Line:
+        case PrimitiveType::Pattern: {
+            // segment pieces of at most 32 pixels, each piece lies within
+            // the pixels of its endpoints
+            Imath::Vec2<float> d = primitive.end - primitive.begin;
+            int steps = std::max(1, (int)std::ceil(std::max(std::abs(d.x), std::abs(d.y)) / 32.0f));
+            int t = primitive.thickness / 2 + 1;
+            for (int i = 0; i < steps; i++) {
+                Imath::Vec2<float> begin = primitive.begin + d * ((float)i / steps);
+                Imath::Vec2<float> end = primitive.begin + d * ((float)(i + 1) / steps);
+                regions.push_back(ROI(
+                    std::floor(std::min(begin.x, end.x)) - t,
+                    std::floor(std::max(begin.x, end.x)) + t + 1,
+                    std::floor(std::min(begin.y, end.y)) - t,
+                    std::floor(std::max(begin.y, end.y)) + t + 1
+                ));
+            }
+            break;
+        }
+        default: {
+            regions.push_back(boundsBy(primitive));
+            break;
+        }
+    }
+    return regions;
+}
+
+std::vector<char> dirtyTilesBy(const DisplayList& previous, const DisplayList& current, ROI roi, int tilesize)
+{
+    int xtiles = (roi.width() + tilesize - 1) / tilesize;
+    int ytiles = (roi.height() + tilesize - 1) / tilesize;
+    std::vector<char> tiles(xtiles * ytiles, 0);
+    
+    auto mark = [&](const Primitive& primitive) {
+        for (const ROI& region : regionsBy(primitive)) {
+            if (!intersects(region, roi)) {
+                continue;
+            }
+            int xbegin = std::max(0, (region.xbegin - roi.xbegin) / tilesize);
+            int xend = std::min(xtiles - 1, (region.xend - 1 - roi.xbegin) / tilesize);
+            int ybegin = std::max(0, (region.ybegin - roi.ybegin) / tilesize);
+            int yend = std::min(ytiles - 1, (region.yend - 1 - roi.ybegin) / tilesize);
+            for (int y = ybegin; y <= yend; y++) {
+                for (int x = xbegin; x <= xend; x++) {
+                    tiles[y * xtiles + x] = 1;
+                }
+            }
+        }
+    };
+    // primitives removed from or added to the display list
+    for (const Primitive& primitive : previous) {
+        if (std::find(current.begin(), current.end(), primitive) == current.end()) {
+            mark(primitive);
+        }
+    }
+    for (const Primitive& primitive : current) {
+        if (std::find(previous.begin(), previous.end(), primitive) == previous.end()) {
+            mark(primitive);
+        }
+    }
+    return tiles;
+}
+
+void renderByTiles(ImageBuf& imagebuf, const DisplayList& displaylist, const std::vector<char>& tiles, int tilesize)
+{
+    ROI roi = imagebuf.roi();
+    int xtiles = (roi.width() + tilesize - 1) / tilesize;
+    DisplayBounds bounds = boundsBy(displaylist);
+    parallel_for(0, tiles.size(), [&](int64_t i) {
+        if (tiles[i]) {
+            int x = roi.xbegin + (i % xtiles) * tilesize;
+            int y = roi.ybegin + (i / xtiles) * tilesize;
+            ROI tile(
+                x,
+                std::min(x + tilesize, roi.xend),
+                y,
+                std::min(y + tilesize, roi.yend)
+            );
+            ImageBufAlgo::zero(imagebuf, tile, 1);
+            renderDisplayList(imagebuf, displaylist, bounds, tile);
+        }
+    });
+}
+
+// generators, each adds the primitives of one composition guide within the
+// aspect ratio and is styled by its name
+void addCenterPoint(DisplayList& displaylist, const Imath::Box2f& arbox, Imath::Vec3<float> color, const SymmetryTool& symmetrytool)
+{
+    Imath::Vec2<float> center = arbox.center();
+    Imath::Vec2<float> size = arbox.size();
+    float cross = std::max(size.x, size.y) * 0.05f;
+    addLine(displaylist, center.x - cross / 2, center.y, center.x + cross / 2, center.y, color);
+    addLine(displaylist, center.x, center.y - cross / 2, center.x, center.y + cross / 2, color);
+}
+
+void addSymmetryGrid(DisplayList& displaylist, const Imath::Box2f& arbox, Imath::Vec3<float> color, const SymmetryTool& symmetrytool)
+{
+    float x0 = arbox.min.x, y0 = arbox.min.y;
+    float x1 = arbox.max.x, y1 = arbox.max.y;
+    
+    // baroque diagonal and diagonals
+    size_t first = displaylist.size();
+    {
+        TraceSpan span("diagonals", "geometry");
+        addLine(displaylist, x0, y1, x1, y0, color);
+        addLine(displaylist, x0, y0, x1, y1, color);
+        styleBy(displaylist, first, "diagonals", symmetrytool);
+    }
+    
+    // reciprocals
+    {
+        Imath::Vec2<float> d = arbox.size();
+        float angle = radiansBy90() - std::atan(d.x / d.y);
+        float length = d.y * std::tan(angle);
+        float hypo = d.y * std::cos(angle);
+        Imath::Vec2<float> cross(
+            hypo * std::sin(angle),
+            hypo * std::cos(angle)
+        );
+                            
+        // diagonals
+        {
+            TraceSpan span("reciprocals", "geometry");
+            first = displaylist.size();
+            addLine(displaylist, x0, y0, x0 + length, y1, color);
+            addLine(displaylist, x0, y1, x0 + length, y0, color);
+            addLine(displaylist, x1, y0, x1 - length, y1, color);
+            addLine(displaylist, x1, y1, x1 - length, y0, color);
+            styleBy(displaylist, first, "reciprocals", symmetrytool);
+        }
+        
+        // rectangles
+        {
+            TraceSpan span("rectangles", "geometry");
+            first = displaylist.size();
+            addLine(displaylist, x0 + cross.x, y0, x0 + cross.x, y1, color);
+            addLine(displaylist, x1 - cross.x, y0, x1 - cross.x, y1, color);
+            addLine(displaylist, x0, y1 - cross.y, x1, y1 - cross.y, color);
+            addLine(displaylist, x0, y0 + cross.y, x1, y0 + cross.y, color);
+            styleBy(displaylist, first, "rectangles", symmetrytool);
+        }
+        
+        // centers
+        {
+            TraceSpan span("centers", "geometry");
+            first = displaylist.size();
+            addPattern(displaylist, x0 + length, y0, x0 + length, y1, color, 5);
+            addPattern(displaylist, x1 - length, y0, x1 - length, y1, color, 5);
+            styleBy(displaylist, first, "centers", symmetrytool);
+        }
+    }
+}
+
+void addThirds(DisplayList& displaylist, const Imath::Box2f& arbox, Imath::Vec3<float> color, const SymmetryTool& symmetrytool)
+{
+    Imath::Vec2<float> size = arbox.size();
+    for (int i = 1; i < 3; i++) {
+        float x = arbox.min.x + size.x * i / 3.0f;
+        float y = arbox.min.y + size.y * i / 3.0f;
+        addLine(displaylist, x, arbox.min.y, x, arbox.max.y, color);
+        addLine(displaylist, arbox.min.x, y, arbox.max.x, y, color);
+    }
+}
+
+void addPhiGrid(DisplayList& displaylist, const Imath::Box2f& arbox, Imath::Vec3<float> color, const SymmetryTool& symmetrytool)
+{
+    // divisions at 1/phi^2 and 1/phi
+    const float phi = (1.0f + std::sqrt(5.0f)) / 2.0f;
+    Imath::Vec2<float> size = arbox.size();
+    for (float t : { 1.0f / (phi * phi), 1.0f / phi }) {
+        float x = arbox.min.x + size.x * t;
+        float y = arbox.min.y + size.y * t;
+        addLine(displaylist, x, arbox.min.y, x, arbox.max.y, color);
+        addLine(displaylist, arbox.min.x, y, arbox.max.x, y, color);
+    }
+}
+
+void addGoldenSpiral(DisplayList& displaylist, const Imath::Box2f& arbox, Imath::Vec3<float> color, const SymmetryTool& symmetrytool)
+{
+    // quarter arcs through pieces cut by 1/phi from the left, top, right and
+    // bottom in turn, stretched to the aspect ratio
+    const float phi = (1.0f + std::sqrt(5.0f)) / 2.0f;
+    float x0 = arbox.min.x, y0 = arbox.min.y;
+    float x1 = arbox.max.x, y1 = arbox.max.y;
+    for (int i = 0; x1 - x0 >= 2.0f && y1 - y0 >= 2.0f; i++) {
+        Imath::Vec2<float> a, b, c;
+        switch (i % 4) {
+            case 0: {
+                float x = x0 + (x1 - x0) / phi;
+                a = Imath::Vec2<float>(x0, y1), b = Imath::Vec2<float>(x, y0), c = Imath::Vec2<float>(x, y1);
+                x0 = x;
+                break;
+            }
+            case 1: {
+                float y = y0 + (y1 - y0) / phi;
+                a = Imath::Vec2<float>(x0, y0), b = Imath::Vec2<float>(x1, y), c = Imath::Vec2<float>(x0, y);
+                y0 = y;
+                break;
+            }
+            case 2: {
+                float x = x1 - (x1 - x0) / phi;
+                a = Imath::Vec2<float>(x1, y0), b = Imath::Vec2<float>(x, y1), c = Imath::Vec2<float>(x, y0);
+                x1 = x;
+                break;
+            }
+            default: {
+                float y = y1 - (y1 - y0) / phi;
+                a = Imath::Vec2<float>(x1, y1), b = Imath::Vec2<float>(x0, y), c = Imath::Vec2<float>(x1, y);
+                y1 = y;
+                break;
+            }
+        }
+        float rx = std::abs(a.x - c.x) + std::abs(b.x - c.x);
+        float ry = std::abs(a.y - c.y) + std::abs(b.y - c.y);
+        int segments = std::max(4, (int)std::ceil((rx + ry) / 8.0f));
+        Imath::Vec2<float> previous = a;
+        for (int s = 1; s <= segments; s++) {
+            float angle = radiansBy90() * s / segments;
+            Imath::Vec2<float> point(
+                c.x + (a.x - c.x) * std::cos(angle) + (b.x - c.x) * std::sin(angle),
+                c.y + (a.y - c.y) * std::cos(angle) + (b.y - c.y) * std::sin(angle)
+            );
+            addLine(displaylist, previous.x, previous.y, point.x, point.y, color);
+            previous = point;
+        }
+    }
+}
+
+void addHarmonicArmature(DisplayList& displaylist, const Imath::Box2f& arbox, Imath::Vec3<float> color, const SymmetryTool& symmetrytool)
+{
+    // diagonals, reciprocals from each corner to the midpoints of the far
+    // sides and the rhombus between midpoints
+    float x0 = arbox.min.x, y0 = arbox.min.y;
+    float x1 = arbox.max.x, y1 = arbox.max.y;
+    float xm = (x0 + x1) / 2, ym = (y0 + y1) / 2;
+    addLine(displaylist, x0, y0, x1, y1, color);
+    addLine(displaylist, x0, y1, x1, y0, color);
+    
+    addLine(displaylist, x0, y0, x1, ym, color);
+    addLine(displaylist, x0, y0, xm, y1, color);
+    addLine(displaylist, x1, y0, x0, ym, color);
+    addLine(displaylist, x1, y0, xm, y1, color);
+    addLine(displaylist, x0, y1, x1, ym, color);
+    addLine(displaylist, x0, y1, xm, y0, color);
+    addLine(displaylist, x1, y1, x0, ym, color);
+    addLine(displaylist, x1, y1, xm, y0, color);
+    
+    addLine(displaylist, xm, y0, x1, ym, color);
+    addLine(displaylist, x1, ym, xm, y1, color);
+    addLine(displaylist, xm, y1, x0, ym, color);
+    addLine(displaylist, x0, ym, xm, y0, color);
+}
+
+void addSafeAreas(DisplayList& displaylist, const Imath::Box2f& arbox, Imath::Vec3<float> color, const SymmetryTool& symmetrytool)
+{
+    // action and title safe, 93% and 90%
+    addBox(displaylist, scaleBy(arbox, 0.93f, 0.93f), color, 1);
+    addBox(displaylist, scaleBy(arbox, 0.90f, 0.90f), color, 1);
+}
+
+typedef void (*SymmetryGenerator)(DisplayList& displaylist, const Imath::Box2f& arbox, Imath::Vec3<float> color, const SymmetryTool& symmetrytool);
+
+struct SymmetryGenerators
+{
+    const char* name;
+    bool SymmetryTool::*enabled;
+    SymmetryGenerator generator;
+};
+
+static const SymmetryGenerators generators[] = {
+    { "centerpoint", &SymmetryTool::centerpoint, addCenterPoint },
+    { "symmetrygrid", &SymmetryTool::symmetrygrid, addSymmetryGrid },
+    { "thirds", &SymmetryTool::thirds, addThirds },
+    { "phigrid", &SymmetryTool::phigrid, addPhiGrid },
+    { "goldenspiral", &SymmetryTool::goldenspiral, addGoldenSpiral },
+    { "harmonic", &SymmetryTool::harmonic, addHarmonicArmature },
+    { "safeareas", &SymmetryTool::safeareas, addSafeAreas }
+};
+
+// symmetry
+void addSymmetry(DisplayList& displaylist, const Imath::Box2f& arbox, Imath::Vec3<float> color, const SymmetryTool& symmetrytool)
+{
+    size_t first = displaylist.size();
+    addBox(displaylist, arbox, color, 2);
+    styleBy(displaylist, first, "aspectratio", symmetrytool);
+    
+    // generators
+    for (const SymmetryGenerators& generator : generators) {
+        if (symmetrytool.*generator.enabled) {
+            TraceSpan span(generator.name, "geometry");
+            first = displaylist.size();
+            generator.generator(displaylist, arbox, color, symmetrytool);
+            styleBy(displaylist, first, generator.name, symmetrytool);
+        }
+    }
+    
+    // label
+    if (symmetrytool.label) {
+        Imath::Vec2<float> size = arbox.size();
+        char label[128];
+        std::snprintf(label, sizeof(label), "size: %g, %g scale: %g", std::round(size.x), std::round(size.y), symmetrytool.scale);
+        
+        addText(
+            displaylist,
+            arbox.min.x + size.x * 0.01f,
+            arbox.max.y + size.x * 0.01f,
+            label,
+            fontBy(symmetrytool).c_str(),
+            ImageBufAlgo::TextAlignY::Top,
+            color
+        );
+        styleBy(displaylist, displaylist.size() - 1, "label", symmetrytool);
+    }
+}
+
+// utils -- font
+std::string moduleDirectory()
+{
+    // directory of the executable or shared library this code is linked into
+#ifdef _WIN32
+    HMODULE module = nullptr;
+    char path[MAX_PATH];
+    if (GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, (LPCSTR)&moduleDirectory, &module) &&
+        GetModuleFileNameA(module, path, MAX_PATH)) {
+        return Filesystem::parent_path(path);
+    }
+#else
+    Dl_info info;
+    if (dladdr((void*)&moduleDirectory, &info) && info.dli_fname) {
+        return Filesystem::parent_path(info.dli_fname);
+    }
+#endif
+    return std::string();
+}
+
+std::string fontBy(const SymmetryTool& symmetrytool)
+{
+    if (symmetrytool.font.size()) {
+        return symmetrytool.font;
+    }
+    // looked up once, one directory up is the build directory of multi
+    // config generators
+    static const std::string font = []() {
+        std::string directory = moduleDirectory();
+        for (const char* name : { "Roboto.ttf", "../Roboto.ttf" }) {
+            std::string path = directory.size() ? directory + "/" + name : std::string(name);
+            if (Filesystem::exists(path)) {
+                return path;
+            }
+        }
+        return std::string("../Roboto.ttf");
+    }();
+    return font;
+}
+
+DisplayList geometryBy(const SymmetryTool& symmetrytool)
+{
+    TraceSpan span("geometry", "geometry");
+    DisplayList displaylist;
+    Imath::Box2f box(Imath::Vec2<float>(0.0f, 0.0f), Imath::Vec2<float>(symmetrytool.size.x, symmetrytool.size.y));
+    addBox(displaylist, box, symmetrytool.color, 2);
+    styleBy(displaylist, 0, "frame", symmetrytool);
+    
+    // aspect ratios, frames within the frame each with its own color, the
+    // first is the keyframed aspect ratio and color
+    ArenaVector<float> ratios(symmetrytool.aspectratios.begin(), symmetrytool.aspectratios.end());
+    if (!ratios.size()) {
+        ratios.push_back(symmetrytool.aspectratio);
+    }
+    ratios[0] = symmetrytool.aspectratio;
+    for (size_t i = 0; i < ratios.size(); i++) {
+        Imath::Vec3<float> color = symmetrytool.color;
+        if (i > 0 && i < symmetrytool.colors.size()) {
+            color = symmetrytool.colors[i];
+        }
+        Imath::Box2f arbox = scaleBy(aspectRatioBy(box, ratios[i]), symmetrytool.scale, symmetrytool.scale);
+        addSymmetry(displaylist, arbox, color, symmetrytool);
+    }
+    
+    // label
+    if (symmetrytool.label) {
+        // formatted on the stack, labels are not allocated
+        char label[512];
+        int length = std::snprintf(label, sizeof(label), "size: %d, %d aspect ratio: ", symmetrytool.size.x, symmetrytool.size.y);
+        for (size_t i = 0; i < ratios.size() && length < (int)sizeof(label); i++) {
+            length += std::snprintf(label + length, sizeof(label) - length, "%s%g", i ? ", " : "", ratios[i]);
+        }
+        
+        addText(
+            displaylist,
+            box.min.x + symmetrytool.size.x * 0.01f,
+            box.max.y - symmetrytool.size.x * 0.01f,
+            label,
+            fontBy(symmetrytool).c_str(),
+            ImageBufAlgo::TextAlignY::Baseline,
+            symmetrytool.color
+        );
+        styleBy(displaylist, displaylist.size() - 1, "label", symmetrytool);
+    }
+    
+    // normalized
+    for (Primitive& primitive : displaylist) {
+        primitive.begin.x /= symmetrytool.size.x;
+        primitive.begin.y /= symmetrytool.size.y;
+        primitive.end.x /= symmetrytool.size.x;
+        primitive.end.y /= symmetrytool.size.y;
+    }
+    return displaylist;
+}
+
+DisplayList rasterBy(const DisplayList& geometry, int width, int height)
+{
+    // pixel coordinates snapped to 1/256 of a pixel so the same geometry
+    // samples the same pixels regardless of float rounding
+    DisplayList displaylist = geometry;
+    for (Primitive& primitive : displaylist) {
+        primitive.begin.x = std::round(primitive.begin.x * width * 256.0f) / 256.0f;
+        primitive.begin.y = std::round(primitive.begin.y * height * 256.0f) / 256.0f;
+        primitive.end.x = std::round(primitive.end.x * width * 256.0f) / 256.0f;
+        primitive.end.y = std::round(primitive.end.y * height * 256.0f) / 256.0f;
+    }
+    
+    // shared edges
+    TraceSpan span("compact", "geometry");
+    compactDisplayList(displaylist);
+    return displaylist;
+}
+
+DisplayList displayListBy(const SymmetryTool& symmetrytool)
+{
+    DisplayList displaylist = rasterBy(geometryBy(symmetrytool), symmetrytool.size.x, symmetrytool.size.y);
+    
+    // st map
+    if (symmetrytool.stmap.size()) {
+        std::shared_ptr<const STMap> stmap = stmapBy(symmetrytool.stmap);
+        if (stmap) {
+            TraceSpan span("warp", "geometry");
+            warpDisplayList(displaylist, *stmap, symmetrytool.size.x, symmetrytool.size.y);
+        }
+    }
+    return displaylist;
+}
+
@@ -0,0 +1,127 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2023 - present Mikael Sundell.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+// imath
+#include <Imath/ImathVec.h>
+
+// openimageio
+#include <OpenImageIO/imagebuf.h>
+#include <OpenImageIO/imagebufalgo.h>
+
+// symmetrytool
+#include "arena.h"
+#include "symmetrytool.h"
+
+// display list, geometry is built in float pixel coordinates and kept
+// normalized to the size, raster lists are scaled to the output size
+enum class PrimitiveType
+{
+    Box,
+    Line,
+    Pattern,
+    Text
+};
+
+struct Primitive
+{
+    PrimitiveType type;
+    Imath::Vec2<float> begin;
+    Imath::Vec2<float> end;
+    Imath::Vec3<float> color;
+    float opacity = 1.0f;
+    int thickness = 1;
+    int interval = 0;
+    ArenaString text;
+    ArenaString font;
+    int fontsize = 12;
+    OIIO::ImageBufAlgo::TextAlignY aligny = OIIO::ImageBufAlgo::TextAlignY::Baseline;
+    
+    bool operator==(const Primitive& other) const
+    {
+        return type == other.type &&
+               begin == other.begin &&
+               end == other.end &&
+               color == other.color &&
+               opacity == other.opacity &&
+               thickness == other.thickness &&
+               interval == other.interval &&
+               text == other.text &&
+               font == other.font &&
+               fontsize == other.fontsize &&
+               aligny == other.aligny;
+    }
+};
+
+// allocated from the arena of the job when one is installed
+typedef ArenaVector<Primitive> DisplayList;
+
+// st map
+struct STMap
+{
+    int width = 0;
+    int height = 0;
+    std::vector<float> st;
+    
+    // st at pixel coordinates, bilinear between pixel centers
+    Imath::Vec2<float> sample(float x, float y) const
+    {
+        x = std::min(std::max(x - 0.5f, 0.0f), (float)width - 1);
+        y = std::min(std::max(y - 0.5f, 0.0f), (float)height - 1);
+        int x0 = std::min((int)x, std::max(width - 2, 0));
+        int y0 = std::min((int)y, std::max(height - 2, 0));
+        int x1 = std::min(x0 + 1, width - 1);
+        int y1 = std::min(y0 + 1, height - 1);
+        float fx = x - x0;
+        float fy = y - y0;
+        Imath::Vec2<float> result;
+        for (int c = 0; c < 2; c++) {
+            float top = st[(y0 * width + x0) * 2 + c] * (1 - fx) + st[(y0 * width + x1) * 2 + c] * fx;
+            float bottom = st[(y1 * width + x0) * 2 + c] * (1 - fx) + st[(y1 * width + x1) * 2 + c] * fx;
+            result[c] = top * (1 - fy) + bottom * fy;
+        }
+        return result;
+    }
+};
+
+// st map read once and shared, null if it could not be read
+std::shared_ptr<const STMap> stmapBy(const std::string& filename);
+
+// font of labels, the font of the symmetry tool or Roboto.ttf next to the
+// executable or library, falls back to ../Roboto.ttf of the working directory
+std::string fontBy(const SymmetryTool& symmetrytool);
+
+// geometry of the symmetry tool, normalized to its size
+DisplayList geometryBy(const SymmetryTool& symmetrytool);
+
+// geometry scaled to pixels of the size with shared edges compacted
+DisplayList rasterBy(const DisplayList& geometry, int width, int height);
+
+// raster display list of the symmetry tool, warped by its st map
+DisplayList displayListBy(const SymmetryTool& symmetrytool);
+
+// pixel bounds of the primitives, computed once and shared by the bands or
+// tiles of one render, text bounds load the font
+typedef ArenaVector<OIIO::ROI> DisplayBounds;
+
+DisplayBounds boundsBy(const DisplayList& displaylist);
+
+// renders primitives blended over the image, within clip if defined
+void renderDisplayList(OIIO::ImageBuf& imagebuf, const DisplayList& displaylist, OIIO::ROI clip = OIIO::ROI());
+
+// renders primitives whose bounds cross clip, for banded and tiled renders
+void renderDisplayList(OIIO::ImageBuf& imagebuf, const DisplayList& displaylist, const DisplayBounds& bounds, OIIO::ROI clip);
+
+// tiles touched by primitives added or removed between display lists
+std::vector<char> dirtyTilesBy(const DisplayList& previous, const DisplayList& current, OIIO::ROI roi, int tilesize);
+
+// clears and re-renders the marked tiles in parallel
+void renderByTiles(OIIO::ImageBuf& imagebuf, const DisplayList& displaylist, const std::vector<char>& tiles, int tilesize);
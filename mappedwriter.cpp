@@ -0,0 +1,218 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2023 - present Mikael Sundell.
+//
+
+#include "mappedwriter.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// openimageio
+#include <OpenImageIO/strutil.h>
+
+using namespace OIIO;
+
+namespace {
+
+// utils -- header
+template <typename T>
+void put(std::vector<unsigned char>& header, size_t offset, T value)
+{
+    std::memcpy(header.data() + offset, &value, sizeof(T));
+}
+
+#ifndef _WIN32
+// utils -- reserve, returns 0 or the error number
+int reserve(int fd, size_t size)
+{
+#    ifdef __APPLE__
+    fstore_t store = { F_ALLOCATEALL, F_PEOFPOSMODE, 0, (off_t)size, 0 };
+    if (fcntl(fd, F_PREALLOCATE, &store) == -1) {
+        return errno;
+    }
+    return ftruncate(fd, size) == 0 ? 0 : errno;
+#    else
+    return posix_fallocate(fd, 0, size);
+#    endif
+}
+#endif
+
+std::vector<unsigned char> tiffHeader(int width, int height, int nchannels, int bytes, bool floating)
+{
+    // header, one directory and the per channel bits and sample format
+    // arrays, written in native byte order marked as II or MM
+    const uint16_t order = 1;
+    bool littleendian = *(const unsigned char*)&order == 1;
+    int entries = nchannels == 4 ? 11 : 10;
+    size_t bitsoffset = 8 + 2 + entries * 12 + 4;
+    size_t formatoffset = bitsoffset + nchannels * 2;
+    size_t dataoffset = (formatoffset + nchannels * 2 + 15) & ~(size_t)15;
+    
+    std::vector<unsigned char> header(dataoffset, 0);
+    header[0] = header[1] = littleendian ? 'I' : 'M';
+    put<uint16_t>(header, 2, 42);
+    put<uint32_t>(header, 4, 8);
+    put<uint16_t>(header, 8, entries);
+    
+    // entries in ascending tag order, short values of count one are left
+    // justified in the value field
+    size_t entry = 10;
+    auto add = [&](uint16_t tag, uint16_t type, uint32_t count, uint32_t value) {
+        put<uint16_t>(header, entry, tag);
+        put<uint16_t>(header, entry + 2, type);
+        put<uint32_t>(header, entry + 4, count);
+        if (type == 3 && count == 1) {
+            put<uint16_t>(header, entry + 8, value);
+        } else {
+            put<uint32_t>(header, entry + 8, value);
+        }
+        entry += 12;
+    };
+    const uint16_t shorttype = 3;
+    const uint16_t longtype = 4;
+    uint32_t databytes = (uint32_t)((size_t)width * height * nchannels * bytes);
+    add(256, longtype, 1, width);                       // image width
+    add(257, longtype, 1, height);                      // image length
+    add(258, shorttype, nchannels, bitsoffset);         // bits per sample
+    add(259, shorttype, 1, 1);                          // no compression
+    add(262, shorttype, 1, 2);                          // rgb
+    add(273, longtype, 1, dataoffset);                  // strip offset
+    add(277, shorttype, 1, nchannels);                  // samples per pixel
+    add(278, longtype, 1, height);                      // rows per strip
+    add(279, longtype, 1, databytes);                   // strip byte count
+    if (nchannels == 4) {
+        add(338, shorttype, 1, 1);                      // associated alpha
+    }
+    add(339, shorttype, nchannels, formatoffset);       // sample format
+    put<uint32_t>(header, entry, 0);
+    
+    for (int c = 0; c < nchannels; c++) {
+        put<uint16_t>(header, bitsoffset + c * 2, bytes * 8);
+        put<uint16_t>(header, formatoffset + c * 2, floating ? 3 : 1);
+    }
+    return header;
+}
+
+std::vector<unsigned char> ppmHeader(int width, int height)
+{
+    std::string header = Strutil::sprintf("P6\n%d %d\n255\n", width, height);
+    return std::vector<unsigned char>(header.begin(), header.end());
+}
+
+}  // namespace
+
+bool isMappedFormat(const std::string& extension, int bytes)
+{
+    std::string format = Strutil::lower(extension);
+    if (format == "tif" || format == "tiff" || format == "raw") {
+        return true;
+    }
+    // 16-bit ppm is big endian, only 8-bit is written in place
+    return format == "ppm" && bytes == 1;
+}
+
+int channelsByMappedFormat(const std::string& extension)
+{
+    return Strutil::lower(extension) == "ppm" ? 3 : 4;
+}
+
+MappedFile::~MappedFile()
+{
+    std::string error;
+    close(error);
+}
+
+bool MappedFile::open(
+    const std::string& filename,
+    int width,
+    int height,
+    int nchannels,
+    int bytes,
+    bool floating,
+    std::string& error
+)
+{
+#ifdef _WIN32
+    error = "memory mapped output is not supported on this platform";
+    return false;
+#else
+    std::string extension = Strutil::lower(filename.substr(filename.find_last_of('.') + 1));
+    size_t pixelbytes = (size_t)width * height * nchannels * bytes;
+    std::vector<unsigned char> header;
+    if (extension == "tif" || extension == "tiff") {
+        if (pixelbytes > UINT32_MAX) {
+            error = "tiff larger than 4 GB can not be memory mapped";
+            return false;
+        }
+        header = tiffHeader(width, height, nchannels, bytes, floating);
+    } else if (extension == "ppm") {
+        header = ppmHeader(width, height);
+    }
+    
+    // the file is sized with its blocks reserved up front and reads back as
+    // zero, a full disk fails here instead of faulting on the first store.
+    // pages are only touched where primitives are rendered
+    offset = header.size();
+    size = offset + pixelbytes;
+    stride = (long long)width * nchannels * bytes;
+    fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        error = Strutil::sprintf("could not open %s: %s", filename, std::strerror(errno));
+        return false;
+    }
+    if (int result = reserve(fd, size)) {
+        error = Strutil::sprintf("could not reserve %s: %s", filename, std::strerror(result));
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+    void* map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        error = Strutil::sprintf("could not map %s: %s", filename, std::strerror(errno));
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+    data = (unsigned char*)map;
+    std::memcpy(data, header.data(), header.size());
+    return true;
+#endif
+}
+
+bool MappedFile::close(std::string& error)
+{
+#ifndef _WIN32
+    bool closed = true;
+    if (data) {
+        // written back before unmapping so write errors are reported
+        if (msync(data, size, MS_SYNC) != 0) {
+            error = Strutil::sprintf("could not write output file: %s", std::strerror(errno));
+            closed = false;
+        }
+        if (munmap(data, size) != 0 && closed) {
+            error = Strutil::sprintf("could not unmap output file: %s", std::strerror(errno));
+            closed = false;
+        }
+        data = nullptr;
+    }
+    if (fd >= 0) {
+        if (::close(fd) != 0 && closed) {
+            error = Strutil::sprintf("could not close output file: %s", std::strerror(errno));
+            closed = false;
+        }
+        fd = -1;
+    }
+    return closed;
+#else
+    return true;
+#endif
+}
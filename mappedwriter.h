@@ -0,0 +1,50 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2023 - present Mikael Sundell.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// returns true if pixels of bytes per channel can be rendered in place into a
+// memory mapped file of extension, uncompressed tiff, raw or 8-bit ppm
+bool isMappedFormat(const std::string& extension, int bytes);
+
+// number of channels of a memory mapped file of extension, ppm has no alpha
+int channelsByMappedFormat(const std::string& extension);
+
+// memory mapped output file, the header is written when the file is opened
+// and pixels are rendered in place into the mapped pixel region, no copy of
+// the image is made. tiff and raw pixels are in native byte order, tiff is
+// a single uncompressed strip with associated alpha.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+    
+    bool open(
+        const std::string& filename,
+        int width,
+        int height,
+        int nchannels,
+        int bytes,
+        bool floating,
+        std::string& error
+    );
+    bool close(std::string& error);
+    
+    unsigned char* pixels() const { return data ? data + offset : nullptr; }
+    long long ystride() const { return stride; }
+
+private:
+    int fd = -1;
+    unsigned char* data = nullptr;
+    size_t size = 0;
+    size_t offset = 0;
+    long long stride = 0;
+};
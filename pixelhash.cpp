@@ -0,0 +1,155 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2023 - present Mikael Sundell.
+//
+
+#include "pixelhash.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+const uint64_t prime1 = 0x9E3779B185EBCA87ull;
+const uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+const uint64_t prime3 = 0x165667B19E3779F9ull;
+const uint64_t prime4 = 0x85EBCA77C2B2AE63ull;
+const uint64_t prime5 = 0x27D4EB2F165667C5ull;
+
+// utils -- xxh64, little endian reads
+inline uint64_t rotl(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t read64(const unsigned char* p)
+{
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+inline uint32_t read32(const unsigned char* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+inline uint64_t round(uint64_t acc, uint64_t input)
+{
+    acc += input * prime2;
+    acc = rotl(acc, 31);
+    return acc * prime1;
+}
+
+inline uint64_t merge(uint64_t acc, uint64_t v)
+{
+    acc ^= round(0, v);
+    return acc * prime1 + prime4;
+}
+
+}
+
+PixelHash::PixelHash(uint64_t seed)
+: seed(seed)
+{
+    v[0] = seed + prime1 + prime2;
+    v[1] = seed + prime2;
+    v[2] = seed;
+    v[3] = seed - prime1;
+}
+
+void PixelHash::update(const void* data, size_t size)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    const unsigned char* end = p + size;
+    total += size;
+    if (buffered + size < 32) {
+        std::memcpy(buffer + buffered, p, size);
+        buffered += size;
+        return;
+    }
+    if (buffered) {
+        size_t fill = 32 - buffered;
+        std::memcpy(buffer + buffered, p, fill);
+        for (int i = 0; i < 4; i++) {
+            v[i] = round(v[i], read64(buffer + i * 8));
+        }
+        p += fill;
+        buffered = 0;
+    }
+    for (; p + 32 <= end; p += 32) {
+        v[0] = round(v[0], read64(p));
+        v[1] = round(v[1], read64(p + 8));
+        v[2] = round(v[2], read64(p + 16));
+        v[3] = round(v[3], read64(p + 24));
+    }
+    buffered = end - p;
+    std::memcpy(buffer, p, buffered);
+}
+
+uint64_t PixelHash::digest() const
+{
+    uint64_t h;
+    if (total >= 32) {
+        h = rotl(v[0], 1) + rotl(v[1], 7) + rotl(v[2], 12) + rotl(v[3], 18);
+        for (int i = 0; i < 4; i++) {
+            h = merge(h, v[i]);
+        }
+    } else {
+        h = seed + prime5;
+    }
+    h += total;
+    
+    const unsigned char* p = buffer;
+    const unsigned char* end = buffer + buffered;
+    for (; p + 8 <= end; p += 8) {
+        h ^= round(0, read64(p));
+        h = rotl(h, 27) * prime1 + prime4;
+    }
+    if (p + 4 <= end) {
+        h ^= (uint64_t)read32(p) * prime1;
+        h = rotl(h, 23) * prime2 + prime3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        h ^= (*p) * prime5;
+        h = rotl(h, 11) * prime1;
+    }
+    h ^= h >> 33;
+    h *= prime2;
+    h ^= h >> 29;
+    h *= prime3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t hashByBands(const std::vector<uint64_t>& bands, int width, int height, int nchannels, int bytes)
+{
+    // dimensions and format first so equal bytes of different layouts
+    // differ, values are hashed as little endian
+    PixelHash hash;
+    auto add = [&hash](uint64_t value) {
+        unsigned char bytes[8];
+        for (int i = 0; i < 8; i++) {
+            bytes[i] = (unsigned char)(value >> (i * 8));
+        }
+        hash.update(bytes, 8);
+    };
+    add(width);
+    add(height);
+    add(nchannels);
+    add(bytes);
+    for (uint64_t band : bands) {
+        add(band);
+    }
+    return hash.digest();
+}
+
+std::string hashString(uint64_t hash)
+{
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)hash);
+    return hex;
+}
@@ -0,0 +1,36 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2023 - present Mikael Sundell.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// xxh64 streaming hash, the same digest as xxhash XXH64 for the same bytes
+// and seed
+class PixelHash
+{
+public:
+    explicit PixelHash(uint64_t seed = 0);
+    
+    void update(const void* data, size_t size);
+    uint64_t digest() const;
+
+private:
+    uint64_t seed;
+    uint64_t v[4];
+    uint64_t total = 0;
+    unsigned char buffer[32];
+    size_t buffered = 0;
+};
+
+// image hash from the hashes of fixed height row bands in order, bands are
+// hashed in parallel and the digest does not depend on the thread count
+uint64_t hashByBands(const std::vector<uint64_t>& bands, int width, int height, int nchannels, int bytes);
+
+// digest as 16 lowercase hex digits
+std::string hashString(uint64_t hash);
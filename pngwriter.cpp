@@ -0,0 +1,399 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2023 - present Mikael Sundell.
+//
+
+#include "pngwriter.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// zlib
+#include <zlib.h>
+
+// openimageio
+#include <OpenImageIO/parallel.h>
+
+using namespace OIIO;
+
+namespace {
+
+// utils -- pixels
+inline uint32_t packColor(unsigned int r, unsigned int g, unsigned int b, unsigned int a)
+{
+    return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+inline uint32_t unassociateColor(const unsigned char* p)
+{
+    unsigned int a = p[3];
+    if (a == 0) {
+        return 0;
+    }
+    if (a == 255) {
+        return packColor(p[0], p[1], p[2], a);
+    }
+    auto c = [a](unsigned int v) { return std::min(255u, (v * 255 + a / 2) / a); };
+    return packColor(c(p[0]), c(p[1]), c(p[2]), a);
+}
+
+// utils -- analysis
+struct PngAnalysis
+{
+    bool gray = true;
+    std::unordered_set<uint32_t> colors;
+};
+
+PngColorType colorTypeByPixels(
+    const unsigned char* pixels,
+    int width,
+    int height,
+    long long ystride,
+    int rowsperblock,
+    std::vector<uint32_t>& palette
+)
+{
+    int blocks = (height + rowsperblock - 1) / rowsperblock;
+    std::vector<PngAnalysis> analysis(blocks);
+    parallel_for(0, blocks, [&](int64_t b) {
+        PngAnalysis& block = analysis[b];
+        int yend = std::min<int>(height, (b + 1) * rowsperblock);
+        uint32_t last = 0;
+        block.colors.insert(last);
+        for (int y = b * rowsperblock; y < yend; y++) {
+            const unsigned char* row = pixels + y * ystride;
+            for (int x = 0; x < width; x++) {
+                uint32_t color = unassociateColor(row + x * 4);
+                if (color != last) {
+                    last = color;
+                    if (block.colors.size() <= 256) {
+                        block.colors.insert(color);
+                    }
+                    block.gray &= ((color & 0xff) == ((color >> 8) & 0xff)) &&
+                                  ((color & 0xff) == ((color >> 16) & 0xff));
+                }
+            }
+        }
+    });
+
+    bool gray = true;
+    std::unordered_set<uint32_t> colors;
+    for (const PngAnalysis& block : analysis) {
+        gray &= block.gray;
+        if (colors.size() <= 256) {
+            colors.insert(block.colors.begin(), block.colors.end());
+        }
+    }
+    if (colors.size() <= 256) {
+        palette.assign(colors.begin(), colors.end());
+        std::sort(palette.begin(), palette.end());
+        return PngColorType::Palette;
+    }
+    if (gray) {
+        return PngColorType::GrayAlpha;
+    }
+    return PngColorType::RGBA;
+}
+
+void paletteByAlpha(
+    const unsigned char* pixels,
+    int width,
+    int height,
+    long long ystride,
+    int rowsperblock,
+    const unsigned char* color,
+    std::vector<uint32_t>& palette
+)
+{
+    int blocks = (height + rowsperblock - 1) / rowsperblock;
+    std::vector<std::vector<char>> levels(blocks, std::vector<char>(256, 0));
+    parallel_for(0, blocks, [&](int64_t b) {
+        std::vector<char>& level = levels[b];
+        int yend = std::min<int>(height, (b + 1) * rowsperblock);
+        for (int y = b * rowsperblock; y < yend; y++) {
+            const unsigned char* row = pixels + y * ystride;
+            for (int x = 0; x < width; x++) {
+                level[row[x * 4 + 3]] = 1;
+            }
+        }
+    });
+    
+    palette.clear();
+    palette.push_back(0);
+    for (int a = 1; a < 256; a++) {
+        for (int b = 0; b < blocks; b++) {
+            if (levels[b][a]) {
+                palette.push_back(packColor(color[0], color[1], color[2], a));
+                break;
+            }
+        }
+    }
+}
+
+// png palette
+struct PngPalette
+{
+    std::unordered_map<uint32_t, unsigned char> indices;
+    std::vector<unsigned char> byalpha;
+    int bitdepth = 8;
+};
+
+// utils -- rows
+void packRow(
+    const unsigned char* src,
+    int width,
+    PngColorType colortype,
+    const PngPalette& palette,
+    unsigned char* dst
+)
+{
+    if (colortype == PngColorType::Palette) {
+        if (palette.bitdepth < 8) {
+            std::fill(dst, dst + (width * palette.bitdepth + 7) / 8, 0);
+        }
+        uint32_t last = 0;
+        unsigned char index = palette.indices.count(0) ? palette.indices.at(0) : 0;
+        for (int x = 0; x < width; x++) {
+            if (palette.byalpha.size()) {
+                index = palette.byalpha[src[x * 4 + 3]];
+            } else {
+                uint32_t color = unassociateColor(src + x * 4);
+                if (color != last) {
+                    last = color;
+                    index = palette.indices.at(color);
+                }
+            }
+            if (palette.bitdepth < 8) {
+                int bit = x * palette.bitdepth;
+                dst[bit / 8] |= index << (8 - palette.bitdepth - bit % 8);
+            } else {
+                dst[x] = index;
+            }
+        }
+        return;
+    }
+    for (int x = 0; x < width; x++) {
+        uint32_t color = unassociateColor(src + x * 4);
+        if (colortype == PngColorType::GrayAlpha) {
+            dst[x * 2] = color & 0xff;
+            dst[x * 2 + 1] = color >> 24;
+        } else {
+            dst[x * 4] = color & 0xff;
+            dst[x * 4 + 1] = (color >> 8) & 0xff;
+            dst[x * 4 + 2] = (color >> 16) & 0xff;
+            dst[x * 4 + 3] = color >> 24;
+        }
+    }
+}
+
+// utils -- chunks
+void writeUInt32(std::ostream& os, uint32_t value)
+{
+    unsigned char bytes[4] = {
+        (unsigned char)(value >> 24),
+        (unsigned char)(value >> 16),
+        (unsigned char)(value >> 8),
+        (unsigned char)(value)
+    };
+    os.write((const char*)bytes, 4);
+}
+
+void writeChunk(std::ostream& os, const char* type, const unsigned char* data, size_t size)
+{
+    uLong crc = crc32(0L, (const Bytef*)type, 4);
+    if (size) {
+        crc = crc32(crc, data, size);
+    }
+    writeUInt32(os, size);
+    os.write(type, 4);
+    os.write((const char*)data, size);
+    writeUInt32(os, crc);
+}
+
+// png block
+struct PngBlock
+{
+    std::vector<unsigned char> data;
+    uLong length = 0;
+    uLong adler = 1L;
+    uLong crc = 0L;
+    int status = Z_OK;
+};
+
+}
+
+bool writePng(
+    std::ostream& os,
+    const unsigned char* pixels,
+    int width,
+    int height,
+    long long ystride,
+    const PngOptions& options,
+    PngColorType* colortype,
+    std::string& error
+)
+{
+    // blocks of at least 512k filtered bytes, deflate ratio loss from
+    // restarting the window per block is negligible at this size
+    int rowsperblock = std::max(1, (512 * 1024) / (width * 4 + 1));
+    int blocks = (height + rowsperblock - 1) / rowsperblock;
+
+    std::vector<uint32_t> palette;
+    PngColorType type = options.colortype;
+    if (options.monochrome) {
+        paletteByAlpha(pixels, width, height, ystride, rowsperblock, options.color, palette);
+        type = PngColorType::Palette;
+    } else if (type == PngColorType::Auto) {
+        type = colorTypeByPixels(pixels, width, height, ystride, rowsperblock, palette);
+    } else if (type == PngColorType::Palette) {
+        if (colorTypeByPixels(pixels, width, height, ystride, rowsperblock, palette) != PngColorType::Palette) {
+            error = "image has more than 256 colors, palette not possible";
+            return false;
+        }
+    }
+    if (colortype) {
+        *colortype = type;
+    }
+
+    PngPalette indices;
+    for (size_t i = 0; i < palette.size(); i++) {
+        indices.indices[palette[i]] = (unsigned char)i;
+    }
+    if (options.monochrome) {
+        indices.byalpha.resize(256, 0);
+        for (size_t i = 0; i < palette.size(); i++) {
+            indices.byalpha[palette[i] >> 24] = (unsigned char)i;
+        }
+    }
+    
+    size_t rowbytes = (size_t)width * 4;
+    unsigned char pngtype = 6;
+    if (type == PngColorType::GrayAlpha) {
+        rowbytes = (size_t)width * 2;
+        pngtype = 4;
+    } else if (type == PngColorType::Palette) {
+        indices.bitdepth = palette.size() <= 2 ? 1 : palette.size() <= 4 ? 2 : palette.size() <= 16 ? 4 : 8;
+        rowbytes = ((size_t)width * indices.bitdepth + 7) / 8;
+        pngtype = 3;
+    }
+
+    // filter and deflate blocks
+    std::vector<PngBlock> pngblocks(blocks);
+    parallel_for(0, blocks, [&](int64_t b) {
+        PngBlock& block = pngblocks[b];
+        int ybegin = b * rowsperblock;
+        int yend = std::min(height, ybegin + rowsperblock);
+
+        // up filter, previous row is repacked for blocks after the first
+        std::vector<unsigned char> prev(rowbytes, 0);
+        std::vector<unsigned char> curr(rowbytes);
+        if (ybegin > 0) {
+            packRow(pixels + (ybegin - 1) * ystride, width, type, indices, prev.data());
+        }
+        std::vector<unsigned char> filtered((yend - ybegin) * (rowbytes + 1));
+        unsigned char* dst = filtered.data();
+        for (int y = ybegin; y < yend; y++) {
+            packRow(pixels + y * ystride, width, type, indices, curr.data());
+            *dst++ = 2;
+            for (size_t i = 0; i < rowbytes; i++) {
+                *dst++ = curr[i] - prev[i];
+            }
+            std::swap(prev, curr);
+        }
+
+        z_stream zs = {};
+        block.status = deflateInit2(&zs, options.compression, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+        if (block.status != Z_OK) {
+            return;
+        }
+        block.data.resize(deflateBound(&zs, filtered.size()) + 16);
+        zs.next_in = filtered.data();
+        zs.avail_in = filtered.size();
+        zs.next_out = block.data.data();
+        zs.avail_out = block.data.size();
+
+        // non-final blocks end on a byte boundary with a sync flush so
+        // the raw streams can be concatenated
+        bool last = (b == blocks - 1);
+        block.status = deflate(&zs, last ? Z_FINISH : Z_SYNC_FLUSH);
+        if (block.status == Z_STREAM_END || (!last && block.status == Z_OK && !zs.avail_in)) {
+            block.status = Z_OK;
+        } else {
+            block.status = Z_BUF_ERROR;
+        }
+        block.data.resize(zs.total_out);
+        deflateEnd(&zs);
+
+        block.length = filtered.size();
+        block.adler = adler32(1L, filtered.data(), filtered.size());
+        block.crc = crc32(crc32(0L, (const Bytef*)"IDAT", 4), block.data.data(), block.data.size());
+    });
+
+    uLong adler = 1L;
+    for (const PngBlock& block : pngblocks) {
+        if (block.status != Z_OK) {
+            error = "could not deflate png data";
+            return false;
+        }
+        adler = adler32_combine(adler, block.adler, block.length);
+    }
+
+    // signature and header
+    static const unsigned char signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+    os.write((const char*)signature, 8);
+
+    unsigned char ihdr[13] = {
+        (unsigned char)(width >> 24), (unsigned char)(width >> 16),
+        (unsigned char)(width >> 8), (unsigned char)(width),
+        (unsigned char)(height >> 24), (unsigned char)(height >> 16),
+        (unsigned char)(height >> 8), (unsigned char)(height),
+        (unsigned char)indices.bitdepth, pngtype, 0, 0, 0
+    };
+    writeChunk(os, "IHDR", ihdr, sizeof(ihdr));
+
+    if (type == PngColorType::Palette) {
+        std::vector<unsigned char> plte;
+        std::vector<unsigned char> trns;
+        for (uint32_t color : palette) {
+            plte.push_back(color & 0xff);
+            plte.push_back((color >> 8) & 0xff);
+            plte.push_back((color >> 16) & 0xff);
+            trns.push_back(color >> 24);
+        }
+        writeChunk(os, "PLTE", plte.data(), plte.size());
+        writeChunk(os, "tRNS", trns.data(), trns.size());
+    }
+
+    // zlib stream split over idat chunks, header and adler trailer in
+    // chunks of their own
+    int level = options.compression < 0 ? 6 : options.compression;
+    unsigned char flevel = level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3;
+    unsigned char zheader[2] = { 0x78, (unsigned char)(flevel << 6) };
+    zheader[1] += (31 - (zheader[0] * 256 + zheader[1]) % 31) % 31;
+    writeChunk(os, "IDAT", zheader, 2);
+
+    for (const PngBlock& block : pngblocks) {
+        writeUInt32(os, block.data.size());
+        os.write("IDAT", 4);
+        os.write((const char*)block.data.data(), block.data.size());
+        writeUInt32(os, block.crc);
+    }
+
+    unsigned char ztrailer[4] = {
+        (unsigned char)(adler >> 24),
+        (unsigned char)(adler >> 16),
+        (unsigned char)(adler >> 8),
+        (unsigned char)(adler)
+    };
+    writeChunk(os, "IDAT", ztrailer, 4);
+    writeChunk(os, "IEND", nullptr, 0);
+
+    if (!os.good()) {
+        error = "could not write png data";
+        return false;
+    }
+    return true;
+}
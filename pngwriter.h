@@ -0,0 +1,43 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2023 - present Mikael Sundell.
+//
+
+#pragma once
+
+#include <ostream>
+#include <string>
+
+// png color type
+enum class PngColorType
+{
+    Auto,
+    RGBA,
+    GrayAlpha,
+    Palette
+};
+
+// png options
+struct PngOptions
+{
+    int compression = 6;
+    PngColorType colortype = PngColorType::Auto;
+    bool monochrome = false;
+    unsigned char color[3] = { 255, 255, 255 };
+};
+
+// writes associated 8-bit rgba pixels as png, rows are filtered and deflated
+// in independent blocks in parallel and concatenated into one zlib stream.
+// with auto color type, single colored images are written as palette or
+// grayscale with alpha. monochrome images of color are indexed by alpha
+// without color analysis, palettes of 2, 4 and 16 entries are bit packed.
+bool writePng(
+    std::ostream& os,
+    const unsigned char* pixels,
+    int width,
+    int height,
+    long long ystride,
+    const PngOptions& options,
+    PngColorType* colortype,
+    std::string& error
+);
@@ -3,12 +3,23 @@
 # define common photo and film aspect ratios
 aspect_ratios=("1.33" "1.5" "1.77" "1.85" "2.35" "2.39")
 
-# loop through the aspect ratios and run symmetrytool for each
+# write one job per aspect ratio and render all jobs with one symmetrytool process
+job_file="./symmetrytool_aspectratios.jobs"
+: > "$job_file"
 for ar in "${aspect_ratios[@]}"; do
     # calculate the width based on the aspect ratio and make it a multiple of 1000
     width=$(echo "scale=0; $ar * 1000 / 1" | bc)
     height=1000    
     output_file="./symmetrytool_${ar}.png"
-    ./symmetrytool --aspectratio "$ar" --outputfile "$output_file" --symmetrygrid --centerpoint --size "${width},${height}" -v -d --scale 1
-    echo "Created $output_file"
+    echo "--aspectratio $ar --outputfile $output_file --symmetrygrid --centerpoint --size ${width},${height} --scale 1" >> "$job_file"
+done
+./symmetrytool --jobfile "$job_file" -v -d
+status=$?
+rm -f "$job_file"
+if [ $status -ne 0 ]; then
+    echo "Failed to create aspect ratio images"
+    exit $status
+fi
+for ar in "${aspect_ratios[@]}"; do
+    echo "Created ./symmetrytool_${ar}.png"
 done
@@ -0,0 +1,33 @@
+#!/bin/bash
+
+# draw kernel benchmark, best raster seconds of each pixel type for rgba and
+# total seconds of the single channel uint8 coverage mask. 3 channel kernels
+# are used by the symmetry library only
+symmetrytool="${1:-./symmetrytool}"
+runs="${2:-5}"
+size="${3:-8192,8192}"
+output_dir="./symmetrytool_kernels"
+
+mkdir -p "$output_dir"
+
+best() {
+    local key="$1"
+    shift
+    local best=""
+    for ((i = 0; i < runs; i++)); do
+        seconds=$("$symmetrytool" --symmetrygrid --thirds --phigrid --harmonic --safeareas --size "$size" --scale 1 --stats "$@" \
+            | grep "$key" | sed 's/.*: //')
+        if [ -z "$best" ] || [ "$(echo "$seconds < $best" | bc -l)" = "1" ]; then
+            best="$seconds"
+        fi
+    done
+    echo "$best"
+}
+
+for datatype in uint8 uint16 half float; do
+    seconds=$(best "Stats raster seconds" --datatype "$datatype" --outputfile "$output_dir/kernel_$datatype.tif")
+    echo "Kernel $datatype x 4: $seconds seconds"
+done
+seconds=$(best "Stats seconds" --outputfile "$output_dir/kernel.mask")
+echo "Kernel uint8 x 1: $seconds seconds"
+rm -rf "$output_dir"
@@ -0,0 +1,37 @@
+#!/bin/bash
+
+# option parsing benchmark, nanoseconds per option from the parse arguments
+# span of the trace. each option is repeated so parsing dominates the span,
+# a run without options is subtracted
+symmetrytool="${1:-./symmetrytool}"
+repeats="${2:-1000}"
+output_file="./symmetrytool_options.png"
+trace_file="./symmetrytool_options.json"
+
+parse() {
+    "$symmetrytool" --trace "$trace_file" --size 16,16 --outputfile "$output_file" "$@" > /dev/null || exit 1
+    grep '"parse arguments"' "$trace_file" | sed 's/.*"dur":\([0-9]*\).*/\1/'
+}
+
+baseline=$(parse)
+options=(
+    "--aspectratio 1.33,1.78,1.85,2.39"
+    "--aspectratio 16:9"
+    "--scale 0.75"
+    "--color 1,0.5,0.25"
+    "--size 1920,1080"
+    "--style diagonals=1,0,0,0.5,thickness=2"
+    "--keyframe 48:scale=1.0"
+    "--budget 2.0,512"
+    "--compression 6"
+    "--tilesize 64"
+)
+for option in "${options[@]}"; do
+    args=()
+    for ((i = 0; i < repeats; i++)); do
+        args+=($option)
+    done
+    microseconds=$(parse "${args[@]}")
+    echo "$option: $(echo "scale=1; ($microseconds - $baseline) * 1000 / $repeats" | bc) ns per option"
+done
+rm -f "$output_file" "$trace_file"
@@ -0,0 +1,37 @@
+#!/bin/bash
+
+# startup benchmark, a 16x16 chart is dominated by process start
+symmetrytool="${1:-./symmetrytool}"
+runs="${2:-20}"
+output_file="./symmetrytool_startup.png"
+
+# seconds since epoch with nanoseconds, python fallback for macos date
+now() {
+    date +%s.%N 2>/dev/null | grep -v N || python3 -c "import time; print(time.time())"
+}
+
+run() {
+    "$symmetrytool" --symmetrygrid --size 16,16 --outputfile "$output_file" > /dev/null
+}
+
+# cold start, file caches are dropped when permitted
+sync
+if [ "$(uname)" = "Darwin" ]; then
+    purge 2>/dev/null
+else
+    echo 3 > /proc/sys/vm/drop_caches 2>/dev/null
+fi
+begin=$(now)
+run || exit 1
+end=$(now)
+echo "Cold start: $(echo "($end - $begin) * 1000" | bc) ms"
+
+# warm start, average of runs after the caches are filled
+run
+begin=$(now)
+for ((i = 0; i < runs; i++)); do
+    run || exit 1
+done
+end=$(now)
+echo "Warm start: $(echo "scale=3; ($end - $begin) * 1000 / $runs" | bc) ms average of $runs runs"
+rm -f "$output_file"
@@ -0,0 +1,207 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2023 - present Mikael Sundell.
+//
+
+#include "spatialindex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// utils -- geometry
+float distanceBy(Imath::Vec2<float> point, Imath::Vec2<float> begin, Imath::Vec2<float> end)
+{
+    Imath::Vec2<float> d = end - begin;
+    float length2 = d.length2();
+    float t = length2 > 0.0f ? std::min(std::max((point - begin).dot(d) / length2, 0.0f), 1.0f) : 0.0f;
+    Imath::Vec2<float> q = begin + d * t;
+    return std::sqrt((point - q).length2());
+}
+
+bool intersects(const Imath::Box2f& box, Imath::Vec2<float> begin, Imath::Vec2<float> end, float radius)
+{
+    // segment clipped to the box grown by radius
+    Imath::Vec2<float> d = end - begin;
+    float p[4] = { -d.x, d.x, -d.y, d.y };
+    float q[4] = {
+        begin.x - (box.min.x - radius),
+        (box.max.x + radius) - begin.x,
+        begin.y - (box.min.y - radius),
+        (box.max.y + radius) - begin.y
+    };
+    float t0 = 0.0f, t1 = 1.0f;
+    for (int i = 0; i < 4; i++) {
+        if (p[i] == 0.0f) {
+            if (q[i] < 0.0f) {
+                return false;
+            }
+        } else {
+            float r = q[i] / p[i];
+            if (p[i] < 0.0f) {
+                t0 = std::max(t0, r);
+            } else {
+                t1 = std::min(t1, r);
+            }
+            if (t0 > t1) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+}
+
+SpatialIndex::SpatialIndex(const DisplayList& displaylist, float cellsize)
+: cellsize(cellsize)
+{
+    for (size_t i = 0; i < displaylist.size(); i++) {
+        const Primitive& primitive = displaylist[i];
+        float radius = primitive.thickness / 2.0f;
+        if (primitive.type == PrimitiveType::Box) {
+            Imath::Vec2<float> a = primitive.begin;
+            Imath::Vec2<float> b = primitive.end;
+            segments.push_back({ a, Imath::Vec2<float>(b.x, a.y), radius, (int)i });
+            segments.push_back({ Imath::Vec2<float>(b.x, a.y), b, radius, (int)i });
+            segments.push_back({ b, Imath::Vec2<float>(a.x, b.y), radius, (int)i });
+            segments.push_back({ Imath::Vec2<float>(a.x, b.y), a, radius, (int)i });
+        } else if (primitive.type == PrimitiveType::Text) {
+            segments.push_back({ primitive.begin, primitive.begin, 0.0f, (int)i });
+        } else {
+            segments.push_back({ primitive.begin, primitive.end, radius, (int)i });
+        }
+    }
+    if (!segments.size()) {
+        return;
+    }
+    
+    // grid over the bounds of all segments
+    Imath::Vec2<float> min(std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+    Imath::Vec2<float> max(-std::numeric_limits<float>::max(), -std::numeric_limits<float>::max());
+    for (const Segment& segment : segments) {
+        min.x = std::min(min.x, std::min(segment.begin.x, segment.end.x) - segment.radius);
+        min.y = std::min(min.y, std::min(segment.begin.y, segment.end.y) - segment.radius);
+        max.x = std::max(max.x, std::max(segment.begin.x, segment.end.x) + segment.radius);
+        max.y = std::max(max.y, std::max(segment.begin.y, segment.end.y) + segment.radius);
+    }
+    origin = Imath::Vec2<float>(std::floor(min.x), std::floor(min.y));
+    xcells = std::max(1, (int)std::ceil((max.x - origin.x) / cellsize) + 1);
+    ycells = std::max(1, (int)std::ceil((max.y - origin.y) / cellsize) + 1);
+    
+    // cells crossed by each segment, walked in steps of at most a cell and
+    // grown by the radius
+    std::vector<std::pair<int, int>> entries;
+    for (size_t i = 0; i < segments.size(); i++) {
+        const Segment& segment = segments[i];
+        Imath::Vec2<float> d = segment.end - segment.begin;
+        int steps = std::max(1, (int)std::ceil(std::max(std::abs(d.x), std::abs(d.y)) / cellsize));
+        size_t first = entries.size();
+        for (int s = 0; s < steps; s++) {
+            Imath::Vec2<float> a = segment.begin + d * ((float)s / steps);
+            Imath::Vec2<float> b = segment.begin + d * ((float)(s + 1) / steps);
+            int xbegin = std::floor((std::min(a.x, b.x) - segment.radius - origin.x) / cellsize);
+            int xend = std::floor((std::max(a.x, b.x) + segment.radius - origin.x) / cellsize);
+            int ybegin = std::floor((std::min(a.y, b.y) - segment.radius - origin.y) / cellsize);
+            int yend = std::floor((std::max(a.y, b.y) + segment.radius - origin.y) / cellsize);
+            for (int y = std::max(0, ybegin); y <= std::min(ycells - 1, yend); y++) {
+                for (int x = std::max(0, xbegin); x <= std::min(xcells - 1, xend); x++) {
+                    entries.push_back(std::make_pair(y * xcells + x, (int)i));
+                }
+            }
+        }
+        std::sort(entries.begin() + first, entries.end());
+        entries.erase(std::unique(entries.begin() + first, entries.end()), entries.end());
+    }
+    
+    // cells as offsets into one array of segment indices
+    offsets.assign(xcells * ycells + 1, 0);
+    for (const std::pair<int, int>& entry : entries) {
+        offsets[entry.first + 1]++;
+    }
+    for (size_t i = 1; i < offsets.size(); i++) {
+        offsets[i] += offsets[i - 1];
+    }
+    cells.resize(entries.size());
+    std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+    for (const std::pair<int, int>& entry : entries) {
+        cells[fill[entry.first]++] = entry.second;
+    }
+}
+
+int
+SpatialIndex::nearest(Imath::Vec2<float> point, float maxdistance, float* distance) const
+{
+    int nearest = -1;
+    float best = maxdistance;
+    if (!segments.size()) {
+        return nearest;
+    }
+    
+    // rings of cells around the cell of the point, segments in ring r are at
+    // least r - 1 cells away
+    int cx = std::floor((point.x - origin.x) / cellsize);
+    int cy = std::floor((point.y - origin.y) / cellsize);
+    int rmin = std::max(std::max(-cx, cx - (xcells - 1)), std::max(-cy, cy - (ycells - 1)));
+    int rmax = std::max(std::max(cx, xcells - 1 - cx), std::max(cy, ycells - 1 - cy));
+    for (int r = std::max(0, rmin); r <= rmax; r++) {
+        if ((r - 1) * cellsize > best) {
+            break;
+        }
+        for (int y = cy - r; y <= cy + r; y++) {
+            if (y < 0 || y >= ycells) {
+                continue;
+            }
+            bool edge = y == cy - r || y == cy + r;
+            for (int x = cx - r; x <= cx + r; x += edge ? 1 : 2 * r) {
+                if (x >= 0 && x < xcells) {
+                    int cell = y * xcells + x;
+                    for (int i = offsets[cell]; i < offsets[cell + 1]; i++) {
+                        const Segment& segment = segments[cells[i]];
+                        float d = std::max(0.0f, distanceBy(point, segment.begin, segment.end) - segment.radius);
+                        if (d < best || (d == best && nearest >= 0 && segment.primitive > nearest)) {
+                            best = d;
+                            nearest = segment.primitive;
+                        }
+                    }
+                }
+                if (r == 0) {
+                    break;
+                }
+            }
+        }
+    }
+    if (distance && nearest >= 0) {
+        *distance = best;
+    }
+    return nearest;
+}
+
+std::vector<int>
+SpatialIndex::query(const Imath::Box2f& box) const
+{
+    std::vector<int> primitives;
+    if (!segments.size()) {
+        return primitives;
+    }
+    int xbegin = std::max(0, (int)std::floor((box.min.x - origin.x) / cellsize));
+    int xend = std::min(xcells - 1, (int)std::floor((box.max.x - origin.x) / cellsize));
+    int ybegin = std::max(0, (int)std::floor((box.min.y - origin.y) / cellsize));
+    int yend = std::min(ycells - 1, (int)std::floor((box.max.y - origin.y) / cellsize));
+    for (int y = ybegin; y <= yend; y++) {
+        for (int x = xbegin; x <= xend; x++) {
+            int cell = y * xcells + x;
+            for (int i = offsets[cell]; i < offsets[cell + 1]; i++) {
+                const Segment& segment = segments[cells[i]];
+                if (intersects(box, segment.begin, segment.end, segment.radius)) {
+                    primitives.push_back(segment.primitive);
+                }
+            }
+        }
+    }
+    std::sort(primitives.begin(), primitives.end());
+    primitives.erase(std::unique(primitives.begin(), primitives.end()), primitives.end());
+    return primitives;
+}
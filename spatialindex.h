@@ -0,0 +1,48 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2023 - present Mikael Sundell.
+//
+
+#pragma once
+
+#include <vector>
+
+// imath
+#include <Imath/ImathBox.h>
+#include <Imath/ImathVec.h>
+
+// symmetrytool
+#include "displaylist.h"
+
+// spatial index over the primitives of a raster display list, a uniform
+// grid of cells holding the segments crossing them. boxes are indexed by
+// their edges and text by its anchor. queries are in pixel coordinates and
+// return display list indices, the display list is not kept.
+class SpatialIndex
+{
+public:
+    explicit SpatialIndex(const DisplayList& displaylist, float cellsize = 32.0f);
+    
+    // nearest primitive within maxdistance of the point, distances are to
+    // the outline of thick primitives, -1 if none
+    int nearest(Imath::Vec2<float> point, float maxdistance, float* distance = nullptr) const;
+    
+    // primitives crossing the box, in display list order
+    std::vector<int> query(const Imath::Box2f& box) const;
+    
+private:
+    struct Segment
+    {
+        Imath::Vec2<float> begin;
+        Imath::Vec2<float> end;
+        float radius;
+        int primitive;
+    };
+    std::vector<Segment> segments;
+    std::vector<int> offsets;
+    std::vector<int> cells;
+    Imath::Vec2<float> origin;
+    float cellsize;
+    int xcells = 0;
+    int ycells = 0;
+};
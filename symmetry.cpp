@@ -0,0 +1,190 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2023 - present Mikael Sundell.
+//
+
+#include "symmetry.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// openimageio
+#include <OpenImageIO/imagebuf.h>
+
+// symmetrytool
+#include "arena.h"
+#include "displaylist.h"
+#include "spatialindex.h"
+#include "symmetrytool.h"
+
+using namespace OIIO;
+
+namespace {
+
+thread_local std::string error;
+
+int failed(const std::string& message)
+{
+    error = message;
+    return 1;
+}
+
+// symmetry tool of the options, 0 on success
+int symmetryBy(const symmetry_options* options, SymmetryTool& symmetrytool)
+{
+    if (options->width <= 0 || options->height <= 0) {
+        return failed("width and height must be positive");
+    }
+    if (options->aspectratio <= 0.0f || options->scale <= 0.0f) {
+        return failed("aspect ratio and scale must be positive");
+    }
+    symmetrytool.size = Imath::Vec2<int>(options->width, options->height);
+    symmetrytool.aspectratio = options->aspectratio;
+    symmetrytool.scale = options->scale;
+    symmetrytool.color = Imath::Vec3<float>(options->color[0], options->color[1], options->color[2]);
+    symmetrytool.centerpoint = options->centerpoint;
+    symmetrytool.symmetrygrid = options->symmetrygrid;
+    symmetrytool.thirds = options->thirds;
+    symmetrytool.phigrid = options->phigrid;
+    symmetrytool.goldenspiral = options->goldenspiral;
+    symmetrytool.harmonic = options->harmonic;
+    symmetrytool.safeareas = options->safeareas;
+    symmetrytool.label = options->label;
+    if (options->font) {
+        symmetrytool.font = options->font;
+    }
+    if (options->stmap) {
+        symmetrytool.stmap = options->stmap;
+        if (!stmapBy(symmetrytool.stmap)) {
+            return failed("could not read st map: " + symmetrytool.stmap);
+        }
+    }
+    return 0;
+}
+
+}
+
+struct symmetry_index
+{
+    SpatialIndex spatialindex;
+};
+
+void
+symmetry_options_init(symmetry_options* options)
+{
+    SymmetryTool symmetrytool;
+    options->width = symmetrytool.size.x;
+    options->height = symmetrytool.size.y;
+    options->channels = 4;
+    options->aspectratio = symmetrytool.aspectratio;
+    options->scale = symmetrytool.scale;
+    options->color[0] = symmetrytool.color.x;
+    options->color[1] = symmetrytool.color.y;
+    options->color[2] = symmetrytool.color.z;
+    options->centerpoint = symmetrytool.centerpoint;
+    options->symmetrygrid = symmetrytool.symmetrygrid;
+    options->thirds = symmetrytool.thirds;
+    options->phigrid = symmetrytool.phigrid;
+    options->goldenspiral = symmetrytool.goldenspiral;
+    options->harmonic = symmetrytool.harmonic;
+    options->safeareas = symmetrytool.safeareas;
+    options->label = symmetrytool.label;
+    options->stmap = nullptr;
+    options->font = nullptr;
+}
+
+int
+symmetry_render(const symmetry_options* options, void* pixels, ptrdiff_t stride, symmetry_format format)
+{
+    error.clear();
+    if (!options || !pixels) {
+        return failed("options and pixels must not be null");
+    }
+    if (options->channels != 3 && options->channels != 4) {
+        return failed("channels must be 3 or 4");
+    }
+    TypeDesc datatype;
+    switch (format) {
+        case SYMMETRY_UINT8: datatype = TypeDesc::UINT8; break;
+        case SYMMETRY_UINT16: datatype = TypeDesc::UINT16; break;
+        case SYMMETRY_HALF: datatype = TypeDesc::HALF; break;
+        case SYMMETRY_FLOAT: datatype = TypeDesc::FLOAT; break;
+        default: return failed("unknown pixel format");
+    }
+    
+    SymmetryTool symmetrytool;
+    if (symmetryBy(options, symmetrytool)) {
+        return 1;
+    }
+    
+    // the display list is allocated from an arena of the calling thread,
+    // rewound on every call
+    thread_local Arena arena;
+    arena.reset();
+    ArenaScope scope(&arena);
+    
+    // the caller buffer is wrapped, pixels are rendered in place
+    ImageSpec spec(options->width, options->height, options->channels, datatype);
+    ImageBuf imagebuf(spec, pixels, AutoStride, stride);
+    renderDisplayList(imagebuf, displayListBy(symmetrytool));
+    if (imagebuf.has_error()) {
+        return failed(imagebuf.geterror());
+    }
+    return 0;
+}
+
+symmetry_index*
+symmetry_index_create(const symmetry_options* options)
+{
+    error.clear();
+    if (!options) {
+        failed("options must not be null");
+        return nullptr;
+    }
+    SymmetryTool symmetrytool;
+    if (symmetryBy(options, symmetrytool)) {
+        return nullptr;
+    }
+    
+    // the index copies the segments of the display list, the arena is
+    // rewound on the next call
+    thread_local Arena arena;
+    arena.reset();
+    ArenaScope scope(&arena);
+    return new symmetry_index { SpatialIndex(displayListBy(symmetrytool)) };
+}
+
+void
+symmetry_index_free(symmetry_index* index)
+{
+    delete index;
+}
+
+int
+symmetry_nearest(const symmetry_index* index, float x, float y, float maxdistance, float* distance)
+{
+    if (!index) {
+        return -1;
+    }
+    return index->spatialindex.nearest(Imath::Vec2<float>(x, y), maxdistance, distance);
+}
+
+int
+symmetry_query(const symmetry_index* index, float xmin, float ymin, float xmax, float ymax, int* primitives, int capacity)
+{
+    if (!index) {
+        return 0;
+    }
+    std::vector<int> crossing = index->spatialindex.query(Imath::Box2f(Imath::V2f(xmin, ymin), Imath::V2f(xmax, ymax)));
+    if (primitives) {
+        std::copy_n(crossing.begin(), std::min((int)crossing.size(), std::max(capacity, 0)), primitives);
+    }
+    return (int)crossing.size();
+}
+
+const char*
+symmetry_error(void)
+{
+    return error.c_str();
+}
@@ -0,0 +1,92 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2023 - present Mikael Sundell.
+//
+
+#pragma once
+
+#include <stddef.h>
+
+// exported when building the library, imported by applications on windows
+#if defined(_WIN32)
+#    if defined(SYMMETRY_EXPORTS)
+#        define SYMMETRY_API __declspec(dllexport)
+#    else
+#        define SYMMETRY_API __declspec(dllimport)
+#    endif
+#else
+#    define SYMMETRY_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// pixel format of the caller buffer
+typedef enum symmetry_format
+{
+    SYMMETRY_UINT8 = 0,
+    SYMMETRY_UINT16 = 1,
+    SYMMETRY_HALF = 2,
+    SYMMETRY_FLOAT = 3
+} symmetry_format;
+
+// symmetry options, flags are 0 or 1
+typedef struct symmetry_options
+{
+    int width;
+    int height;
+    int channels;
+    float aspectratio;
+    float scale;
+    float color[3];
+    int centerpoint;
+    int symmetrygrid;
+    int thirds;
+    int phigrid;
+    int goldenspiral;
+    int harmonic;
+    int safeareas;
+    int label;
+    const char* stmap;
+    const char* font;
+} symmetry_options;
+
+// sets the defaults of the symmetrytool command line, 1024x1024 rgba. the
+// label font is null for the Roboto.ttf installed next to the library
+SYMMETRY_API void symmetry_options_init(symmetry_options* options);
+
+// renders into the caller buffer of width x height pixels of 3 or 4
+// channels, rgba has alpha last. stride is the distance in bytes between
+// rows, may be negative for bottom up buffers. primitives are blended over
+// the existing pixels, clear the buffer for an overlay. rgb buffers have no
+// alpha and the premultiplied color is written as is. returns 0 on
+// success, the error is returned by symmetry_error.
+SYMMETRY_API int symmetry_render(const symmetry_options* options, void* pixels, ptrdiff_t stride, symmetry_format format);
+
+// spatial index over the primitives of a chart for hit testing in review
+// applications, positions are in pixels of the chart and primitives are
+// numbered in the order they are rendered
+typedef struct symmetry_index symmetry_index;
+
+// builds the index of the chart of the options without rendering it,
+// returns null on failure, the error is returned by symmetry_error.
+SYMMETRY_API symmetry_index* symmetry_index_create(const symmetry_options* options);
+
+SYMMETRY_API void symmetry_index_free(symmetry_index* index);
+
+// nearest primitive within maxdistance of x, y, distances are to the
+// outline of thick primitives. returns -1 if none, distance may be null.
+SYMMETRY_API int symmetry_nearest(const symmetry_index* index, float x, float y, float maxdistance, float* distance);
+
+// primitives crossing the box in rendering order, up to capacity are
+// written to primitives. returns the number of crossing primitives, which
+// may be more than capacity.
+SYMMETRY_API int symmetry_query(const symmetry_index* index, float xmin, float ymin, float xmax, float ymax, int* primitives, int capacity);
+
+// last error of the calling thread
+SYMMETRY_API const char* symmetry_error(void);
+
+#ifdef __cplusplus
+}
+#endif
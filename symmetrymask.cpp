@@ -0,0 +1,122 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2023 - present Mikael Sundell.
+//
+
+#include "symmetrymask.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace {
+
+thread_local std::string error;
+
+symmetry_mask* failed(const std::string& message, FILE* file = nullptr, void* data = nullptr)
+{
+    error = message;
+    if (file) {
+        fclose(file);
+    }
+    free(data);
+    return nullptr;
+}
+
+bool isLittleEndian()
+{
+    const uint16_t order = 1;
+    return *(const unsigned char*)&order == 1;
+}
+
+}
+
+symmetry_mask*
+symmetry_mask_read(const char* filename)
+{
+    error.clear();
+    if (!isLittleEndian()) {
+        return failed("coverage masks are little endian and can not be read on this host");
+    }
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        return failed(std::string("could not open mask file: ") + filename);
+    }
+    
+    symmetry_mask_header header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, SYMMETRY_MASK_MAGIC, 4) != 0) {
+        return failed(std::string("not a mask file: ") + filename, file);
+    }
+    if (header.version != SYMMETRY_MASK_VERSION) {
+        return failed("unsupported mask version: " + std::to_string(header.version), file);
+    }
+    if (header.spancount > (uint64_t)header.width * header.height) {
+        return failed("mask file has more spans than pixels", file);
+    }
+    
+    // mask, rows and spans are read into one allocation
+    size_t rowbytes = ((size_t)header.height + 1) * sizeof(uint64_t);
+    size_t spanbytes = (size_t)header.spancount * sizeof(symmetry_mask_span);
+    unsigned char* data = (unsigned char*)malloc(sizeof(symmetry_mask) + rowbytes + spanbytes);
+    if (!data) {
+        return failed("could not allocate mask", file);
+    }
+    uint64_t* rows = (uint64_t*)(data + sizeof(symmetry_mask));
+    symmetry_mask_span* spans = (symmetry_mask_span*)(data + sizeof(symmetry_mask) + rowbytes);
+    if (fread(rows, 1, rowbytes, file) != rowbytes || fread(spans, 1, spanbytes, file) != spanbytes) {
+        return failed(std::string("truncated mask file: ") + filename, file, data);
+    }
+    fclose(file);
+    
+    // rows are validated once so rows can be expanded without checks
+    if (rows[0] != 0 || rows[header.height] != header.spancount) {
+        return failed("mask rows do not match span count", nullptr, data);
+    }
+    for (uint32_t y = 0; y < header.height; y++) {
+        if (rows[y + 1] < rows[y]) {
+            return failed("mask rows are not sorted", nullptr, data);
+        }
+        for (uint64_t s = rows[y]; s < rows[y + 1]; s++) {
+            if ((uint64_t)spans[s].x + spans[s].length > header.width) {
+                return failed("mask span outside of row: " + std::to_string(y), nullptr, data);
+            }
+        }
+    }
+    
+    symmetry_mask* mask = (symmetry_mask*)data;
+    mask->width = header.width;
+    mask->height = header.height;
+    mask->spancount = header.spancount;
+    mask->rows = rows;
+    mask->spans = spans;
+    return mask;
+}
+
+int
+symmetry_mask_row(const symmetry_mask* mask, uint32_t y, unsigned char* coverage)
+{
+    error.clear();
+    if (!mask || !coverage || y >= mask->height) {
+        error = "mask and coverage must not be null and row within height";
+        return 1;
+    }
+    memset(coverage, 0, mask->width);
+    for (uint64_t s = mask->rows[y]; s < mask->rows[y + 1]; s++) {
+        memset(coverage + mask->spans[s].x, mask->spans[s].coverage, mask->spans[s].length);
+    }
+    return 0;
+}
+
+void
+symmetry_mask_free(symmetry_mask* mask)
+{
+    free(mask);
+}
+
+const char*
+symmetry_mask_error(void)
+{
+    return error.c_str();
+}
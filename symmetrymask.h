@@ -0,0 +1,76 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2023 - present Mikael Sundell.
+//
+
+#pragma once
+
+#include <stdint.h>
+
+// exported when building the library, imported by applications on windows
+#if defined(_WIN32)
+#    if defined(SYMMETRY_MASK_EXPORTS)
+#        define SYMMETRY_MASK_API __declspec(dllexport)
+#    else
+#        define SYMMETRY_MASK_API __declspec(dllimport)
+#    endif
+#else
+#    define SYMMETRY_MASK_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// coverage mask file, little endian
+//   header  symmetry_mask_header
+//   rows    uint64_t index of the first span of each row, height + 1 entries
+//   spans   symmetry_mask_span runs of constant non zero coverage, sorted by
+//           x within each row, runs longer than 65535 pixels are split
+#define SYMMETRY_MASK_MAGIC "SYMK"
+#define SYMMETRY_MASK_VERSION 1
+
+typedef struct symmetry_mask_header
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint64_t spancount;
+} symmetry_mask_header;
+
+typedef struct symmetry_mask_span
+{
+    uint32_t x;
+    uint16_t length;
+    uint8_t coverage;
+    uint8_t reserved;
+} symmetry_mask_span;
+
+// coverage mask read into memory, spans of row y are
+// spans[rows[y]] to spans[rows[y + 1]]
+typedef struct symmetry_mask
+{
+    uint32_t width;
+    uint32_t height;
+    uint64_t spancount;
+    const uint64_t* rows;
+    const symmetry_mask_span* spans;
+} symmetry_mask;
+
+// reads and validates a coverage mask file, returns null on failure, the
+// error is returned by symmetry_mask_error
+SYMMETRY_MASK_API symmetry_mask* symmetry_mask_read(const char* filename);
+
+// expands row y into width bytes of 8-bit coverage, returns 0 on success
+SYMMETRY_MASK_API int symmetry_mask_row(const symmetry_mask* mask, uint32_t y, unsigned char* coverage);
+
+// frees a mask returned by symmetry_mask_read
+SYMMETRY_MASK_API void symmetry_mask_free(symmetry_mask* mask);
+
+// last error of the calling thread
+SYMMETRY_MASK_API const char* symmetry_mask_error(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -6,10 +6,28 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <deque>
+#include <future>
+#include <memory>
 #include <algorithm>
 #include <cmath>
+#include <iomanip>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <map>
+#include <limits>
+#include <cctype>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
 
 // imath
+#include <Imath/ImathBox.h>
 #include <Imath/ImathMatrix.h>
 #include <Imath/ImathVec.h>
 
@@ -18,250 +36,2005 @@
 #include <OpenImageIO/typedesc.h>
 #include <OpenImageIO/argparse.h>
 #include <OpenImageIO/filesystem.h>
+#include <OpenImageIO/parallel.h>
+#include <OpenImageIO/strutil.h>
+#include <OpenImageIO/timer.h>
 #include <OpenImageIO/sysutil.h>
 
 #include <OpenImageIO/imagebuf.h>
 #include <OpenImageIO/imagebufalgo.h>
+#include <OpenImageIO/imagecache.h>
+
+// symmetrytool
+#include "arena.h"
+#include "displaylist.h"
+#include "mappedwriter.h"
+#include "pixelhash.h"
+#include "pngwriter.h"
+#include "spatialindex.h"
+#include "symmetrymask.h"
+#include "symmetrytool.h"
+#include "trace.h"
 
 using namespace OIIO;
 
-// prints
+// prints, moved to stderr when the image is written to stdout. lines are
+// serialized, scheduler and pipeline threads print concurrently
+static std::ostream* printstream = &std::cout;
+static std::mutex printmutex;
+
 template <typename T>
 static void
 print_info(std::string param, const T& value)
 {
-    std::cout << "info: " << param << value << std::endl;
+    std::lock_guard<std::mutex> lock(printmutex);
+    *printstream << "info: " << param << value << std::endl;
 }
 
 template <typename T>
 static void
 print_warning(std::string param, const T& value)
 {
-    std::cout << "warning: " << param << value << std::endl;
+    std::lock_guard<std::mutex> lock(printmutex);
+    *printstream << "warning: " << param << value << std::endl;
 }
 
 template <typename T>
 static void
 print_error(std::string param, const T& value)
 {
+    std::lock_guard<std::mutex> lock(printmutex);
     std::cerr << "error: " << param << value << std::endl;
 }
 
-// symmetry tool
-struct SymmetryTool
-{
-    bool help = false;
-    bool verbose = false;
-    std::string outputfile;
-    float aspectratio = 1.5f;
-    float scale = 0.5f;
-    Imath::Vec3<float> color = Imath::Vec3<float>(1.0f, 1.0f, 1.0f);
-    Imath::Vec2<int> size = Imath::Vec2<int>(1024, 1024);
-    bool centerpoint = false;
-    bool symmetrygrid = false;
-    bool label = false;
-    bool debug;
-    int code = EXIT_SUCCESS;
+// utils -- parse, locale free and strict, errors hold the position in the
+// string of the first character that could not be parsed
+class Parser
+{
+public:
+    explicit Parser(const std::string& text)
+    : text(text)
+    {}
+    
+    bool accept(char c)
+    {
+        space();
+        if (pos < text.size() && text[pos] == c) {
+            pos++;
+            return true;
+        }
+        return false;
+    }
+    
+    bool letter()
+    {
+        space();
+        return pos < text.size() && std::isalpha((unsigned char)text[pos]);
+    }
+    
+    bool expect(char c)
+    {
+        return accept(c) || fail(std::string("expected '") + c + "'");
+    }
+    
+    bool end()
+    {
+        space();
+        return pos == text.size() || fail("unexpected '" + text.substr(pos) + "'");
+    }
+    
+    bool number(float& value)
+    {
+        space();
+        size_t begin = pos;
+        bool negative = false;
+        if (pos < text.size() && (text[pos] == '+' || text[pos] == '-')) {
+            negative = text[pos++] == '-';
+        }
+        // mantissa digits beyond 18 only move the exponent
+        unsigned long long mantissa = 0;
+        int exponent = 0;
+        int digits = 0;
+        for (bool fraction = false; pos < text.size(); pos++) {
+            char c = text[pos];
+            if (c == '.' && !fraction) {
+                fraction = true;
+            } else if (c >= '0' && c <= '9') {
+                if (mantissa < 100000000000000000ull) {
+                    mantissa = mantissa * 10 + (c - '0');
+                    exponent -= fraction;
+                } else {
+                    exponent += !fraction;
+                }
+                digits++;
+            } else {
+                break;
+            }
+        }
+        if (!digits) {
+            pos = begin;
+            return fail("expected number");
+        }
+        if (pos < text.size() && (text[pos] == 'e' || text[pos] == 'E')) {
+            size_t e = pos++;
+            int sign = 1;
+            if (pos < text.size() && (text[pos] == '+' || text[pos] == '-')) {
+                sign = text[pos++] == '-' ? -1 : 1;
+            }
+            int power = 0;
+            size_t first = pos;
+            while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9') {
+                power = std::min(power * 10 + (text[pos++] - '0'), 1000);
+            }
+            if (pos == first) {
+                pos = e;
+            } else {
+                exponent += sign * power;
+            }
+        }
+        double result = mantissa * std::pow(10.0, exponent);
+        if (result > std::numeric_limits<float>::max()) {
+            pos = begin;
+            return fail("number out of range");
+        }
+        value = negative ? -result : result;
+        return true;
+    }
+    
+    bool integer(int& value)
+    {
+        space();
+        size_t begin = pos;
+        bool negative = false;
+        if (pos < text.size() && (text[pos] == '+' || text[pos] == '-')) {
+            negative = text[pos++] == '-';
+        }
+        long long result = 0;
+        size_t first = pos;
+        while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9') {
+            result = result * 10 + (text[pos++] - '0');
+            if (result > std::numeric_limits<int>::max()) {
+                pos = begin;
+                return fail("integer out of range");
+            }
+        }
+        if (pos == first) {
+            pos = begin;
+            return fail("expected integer");
+        }
+        value = negative ? -result : result;
+        return true;
+    }
+    
+    bool name(std::string& value)
+    {
+        space();
+        size_t begin = pos;
+        while (pos < text.size() && (std::isalpha((unsigned char)text[pos]) || (pos > begin && std::isdigit((unsigned char)text[pos])))) {
+            pos++;
+        }
+        if (pos == begin) {
+            return fail("expected name");
+        }
+        value = Strutil::lower(text.substr(begin, pos - begin));
+        return true;
+    }
+    
+    // integer within min and max
+    bool integer(int& value, int min, int max)
+    {
+        size_t begin = pos;
+        if (!integer(value)) {
+            return false;
+        }
+        if (value < min || value > max) {
+            pos = begin;
+            return fail("expected integer " + std::to_string(min) + "-" + std::to_string(max));
+        }
+        return true;
+    }
+    
+    // image dimension, positive and within the limits of an image spec
+    bool dimension(int& value)
+    {
+        size_t begin = pos;
+        if (!integer(value)) {
+            return false;
+        }
+        if (value < 1 || value > 65536) {
+            pos = begin;
+            return fail("expected dimension 1-65536");
+        }
+        return true;
+    }
+    
+    bool positive(float& value)
+    {
+        size_t begin = pos;
+        if (!number(value)) {
+            return false;
+        }
+        if (!(value > 0.0f)) {
+            pos = begin;
+            return fail("expected positive number");
+        }
+        return true;
+    }
+    
+    // number, ratio as width:height or name
+    bool aspectratio(float& value)
+    {
+        static const std::map<std::string, float> names = {
+            { "square", 1.0f },
+            { "academy", 1.375f },
+            { "imax", 1.43f },
+            { "vistavision", 1.5f },
+            { "hdtv", 16.0f / 9.0f },
+            { "flat", 1.85f },
+            { "univisium", 2.0f },
+            { "scope", 2.39f }
+        };
+        space();
+        size_t begin = pos;
+        if (letter()) {
+            std::string ratio;
+            name(ratio);
+            auto it = names.find(ratio);
+            if (it == names.end()) {
+                pos = begin;
+                return fail("unknown aspect ratio '" + ratio + "'");
+            }
+            value = it->second;
+            return true;
+        }
+        if (!positive(value)) {
+            return false;
+        }
+        if (accept(':')) {
+            float height = 0.0f;
+            if (!positive(height)) {
+                return false;
+            }
+            value /= height;
+        }
+        return true;
+    }
+    
+    bool color(Imath::Vec3<float>& value)
+    {
+        return number(value.x) && expect(',') && number(value.y) && expect(',') && number(value.z);
+    }
+    
+    std::string errorBy(const std::string& what) const
+    {
+        return "could not parse " + what + " from string: '" + text + "', " + error;
+    }
+    
+private:
+    void space()
+    {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t')) {
+            pos++;
+        }
+    }
+    
+    bool fail(const std::string& message)
+    {
+        if (error.empty()) {
+            error = message + " at position " + std::to_string(pos + 1);
+        }
+        return false;
+    }
+    
+    std::string text;
+    std::string error;
+    size_t pos = 0;
+};
+
+static const char* styleclasses[] = {
+    "frame", "aspectratio", "centerpoint", "diagonals", "reciprocals", "rectangles", "centers",
+    "thirds", "phigrid", "goldenspiral", "harmonic", "safeareas", "label"
+};
+
+static SymmetryTool tool;
+
+static int
+set_outputfile(int argc, const char* argv[])
+{
+    OIIO_DASSERT(argc == 2);
+    tool.outputfile = argv[1];
+    return 0;
+}
+
+// --aspectratio
+static int
+set_aspectratio(int argc, const char* argv[])
+{
+    OIIO_DASSERT(argc == 2);
+    Parser parser(argv[1]);
+    std::vector<float> aspectratios;
+    float aspectratio = 0.0f;
+    bool valid = true;
+    do {
+        valid = parser.aspectratio(aspectratio);
+        aspectratios.push_back(aspectratio);
+    } while (valid && parser.accept(','));
+    if (!valid || !parser.end()) {
+        print_error(parser.errorBy("aspect ratio"), "");
+        tool.code = EXIT_FAILURE;
+        return 1;
+    } else {
+        tool.aspectratios = aspectratios;
+        tool.aspectratio = tool.aspectratios.front();
+        return 0;
+    }
+}
+
+// --scale
+static int
+set_scale(int argc, const char* argv[])
+{
+    OIIO_DASSERT(argc == 2);
+    Parser parser(argv[1]);
+    float scale = 0.0f;
+    if (!parser.positive(scale) || !parser.end()) {
+        print_error(parser.errorBy("scale"), "");
+        tool.code = EXIT_FAILURE;
+        return 1;
+    } else {
+        tool.scale = scale;
+        return 0;
+    }
+}
+
+// --color
+static int
+set_color(int argc, const char* argv[])
+{
+    OIIO_DASSERT(argc == 2);
+    Parser parser(argv[1]);
+    std::vector<Imath::Vec3<float>> colors;
+    Imath::Vec3<float> color;
+    bool valid = true;
+    do {
+        valid = parser.color(color);
+        colors.push_back(color);
+    } while (valid && parser.accept(';'));
+    if (!valid || !parser.end()) {
+        print_error(parser.errorBy("color"), "");
+        tool.code = EXIT_FAILURE;
+        return 1;
+    } else {
+        tool.colors = colors;
+        tool.color = tool.colors.front();
+        return 0;
+    }
+}
+
+// --size
+static int
+set_size(int argc, const char* argv[])
+{
+    OIIO_DASSERT(argc == 2);
+    Parser parser(argv[1]);
+    Imath::Vec2<int> size;
+    if (!parser.dimension(size.x) || !parser.expect(',') || !parser.dimension(size.y) || !parser.end()) {
+        print_error(parser.errorBy("size"), "");
+        tool.code = EXIT_FAILURE;
+        return 1;
+    } else {
+        tool.size = size;
+        return 0;
+    }
+}
+
+// --datatype
+static int
+set_datatype(int argc, const char* argv[])
+{
+    OIIO_DASSERT(argc == 2);
+    std::string datatype = Strutil::lower(argv[1]);
+    if (datatype == "uint8" || datatype == "uint16" || datatype == "half" || datatype == "float") {
+        tool.datatype = TypeDesc(datatype);
+        return 0;
+    } else {
+        print_error("could not parse datatype from string: ", argv[1]);
+        tool.code = EXIT_FAILURE;
+        return 1;
+    }
+}
+
+// --sequence
+static int
+set_sequence(int argc, const char* argv[])
+{
+    OIIO_DASSERT(argc == 2);
+    Parser parser(argv[1]);
+    Imath::Vec2<int> frames;
+    if (!parser.integer(frames.x) || !parser.expect('-') || !parser.integer(frames.y) || !parser.end()) {
+        print_error(parser.errorBy("sequence"), "");
+        tool.code = EXIT_FAILURE;
+        return 1;
+    } else if (frames.y < frames.x) {
+        print_error("sequence end frame before start frame in string: ", argv[1]);
+        tool.code = EXIT_FAILURE;
+        return 1;
+    } else {
+        tool.frames = frames;
+        tool.sequence = true;
+        return 0;
+    }
+}
+
+// --keyframe
+static int
+set_keyframe(int argc, const char* argv[])
+{
+    OIIO_DASSERT(argc == 2);
+    Parser parser(argv[1]);
+    int frame = 0;
+    std::string param;
+    if (!parser.integer(frame) || !parser.expect(':') || !parser.name(param) || !parser.expect('=')) {
+        print_error(parser.errorBy("keyframe"), "");
+        tool.code = EXIT_FAILURE;
+        return 1;
+    }
+    bool valid = false;
+    if (param == "aspectratio") {
+        float aspectratio = 0.0f;
+        if ((valid = parser.aspectratio(aspectratio) && parser.end())) {
+            tool.aspectratiokeys.push_back(std::make_pair(frame, aspectratio));
+        }
+    } else if (param == "scale") {
+        float scale = 0.0f;
+        if ((valid = parser.positive(scale) && parser.end())) {
+            tool.scalekeys.push_back(std::make_pair(frame, scale));
+        }
+    } else if (param == "color") {
+        Imath::Vec3<float> color;
+        if ((valid = parser.color(color) && parser.end())) {
+            tool.colorkeys.push_back(std::make_pair(frame, color));
+        }
+    } else {
+        print_error("unknown keyframe parameter: ", param);
+        tool.code = EXIT_FAILURE;
+        return 1;
+    }
+    if (!valid) {
+        print_error(parser.errorBy("keyframe"), "");
+        tool.code = EXIT_FAILURE;
+        return 1;
+    } else {
+        return 0;
+    }
+}
+
+// --style
+static int
+set_style(int argc, const char* argv[])
+{
+    OIIO_DASSERT(argc == 2);
+    Parser parser(argv[1]);
+    std::string name;
+    if (!parser.name(name) || !parser.expect('=')) {
+        print_error(parser.errorBy("style"), "");
+        tool.code = EXIT_FAILURE;
+        return 1;
+    }
+    if (std::find(std::begin(styleclasses), std::end(styleclasses), name) == std::end(styleclasses)) {
+        print_error("unknown style class in string: ", argv[1]);
+        tool.code = EXIT_FAILURE;
+        return 1;
+    }
+    // color values first, followed by named values
+    SymmetryStyle symmetrystyle = tool.styles[name];
+    std::vector<float> values;
+    bool valid = true;
+    do {
+        std::string param;
+        float value = 0.0f;
+        if (!parser.letter()) {
+            valid = parser.number(value);
+            values.push_back(value);
+        } else if (!parser.name(param) || !parser.expect('=')) {
+            valid = false;
+        } else if (param == "opacity") {
+            valid = parser.number(symmetrystyle.opacity);
+        } else if (param == "thickness") {
+            valid = parser.integer(symmetrystyle.thickness);
+        } else if (param == "dash") {
+            valid = parser.integer(symmetrystyle.dash);
+        } else {
+            print_error("unknown style parameter: ", param);
+            tool.code = EXIT_FAILURE;
+            return 1;
+        }
+    } while (valid && parser.accept(','));
+    if (!valid || !parser.end()) {
+        print_error(parser.errorBy("style"), "");
+        tool.code = EXIT_FAILURE;
+        return 1;
+    }
+    if (values.size() == 1 || values.size() == 2 || values.size() > 4) {
+        print_error("expected r,g,b or r,g,b,opacity color in style string: ", argv[1]);
+        tool.code = EXIT_FAILURE;
+        return 1;
+    }
+    if (values.size()) {
+        symmetrystyle.hascolor = true;
+        symmetrystyle.color = Imath::Vec3<float>(values[0], values[1], values[2]);
+        if (values.size() == 4) {
+            symmetrystyle.opacity = values[3];
+        }
+    }
+    if (symmetrystyle.opacity < 0.0f || symmetrystyle.opacity > 1.0f ||
+        symmetrystyle.thickness < 0 || symmetrystyle.dash < -1) {
+        print_error("style opacity, thickness or dash out of range in string: ", argv[1]);
+        tool.code = EXIT_FAILURE;
+        return 1;
+    } else {
+        tool.styles[name] = symmetrystyle;
+        return 0;
+    }
+}
+
+// --pick
+static int
+set_pick(int argc, const char* argv[])
+{
+    OIIO_DASSERT(argc == 2);
+    Parser parser(argv[1]);
+    Imath::Vec2<float> pickpoint;
+    if (!parser.number(pickpoint.x) || !parser.expect(',') || !parser.number(pickpoint.y) || !parser.end()) {
+        print_error(parser.errorBy("pick"), "");
+        tool.code = EXIT_FAILURE;
+        return 1;
+    } else {
+        tool.pickpoint = pickpoint;
+        tool.pick = true;
+        return 0;
+    }
+}
+
+// --budget
+static int
+set_budget(int argc, const char* argv[])
+{
+    OIIO_DASSERT(argc == 2);
+    Parser parser(argv[1]);
+    Imath::Vec2<float> budget;
+    if (!parser.positive(budget.x) || !parser.expect(',') || !parser.positive(budget.y) || !parser.end()) {
+        print_error(parser.errorBy("budget"), "");
+        tool.code = EXIT_FAILURE;
+        return 1;
+    } else {
+        tool.budget = budget;
+        return 0;
+    }
+}
+
+// --compression
+static int
+set_compression(int argc, const char* argv[])
+{
+    OIIO_DASSERT(argc == 2);
+    Parser parser(argv[1]);
+    int compression = 0;
+    if (!parser.integer(compression, 0, 9) || !parser.end()) {
+        print_error(parser.errorBy("compression"), "");
+        tool.code = EXIT_FAILURE;
+        return 1;
+    } else {
+        tool.compression = compression;
+        return 0;
+    }
+}
+
+// --tilesize
+static int
+set_tilesize(int argc, const char* argv[])
+{
+    OIIO_DASSERT(argc == 2);
+    Parser parser(argv[1]);
+    int tilesize = 0;
+    if (!parser.integer(tilesize, 16, 65536) || !parser.end()) {
+        print_error(parser.errorBy("tile size"), "");
+        tool.code = EXIT_FAILURE;
+        return 1;
+    } else if (tilesize % 16) {
+        print_error("tile size must be a multiple of 16 in string: ", argv[1]);
+        tool.code = EXIT_FAILURE;
+        return 1;
+    } else {
+        tool.tilesize = tilesize;
+        return 0;
+    }
+}
+
+// --help
+static void
+print_help(ArgParse& ap)
+{
+    ap.print_help();
+}
+
+// utils -- format
+static const int64_t smallchart = 256 * 256;
+
+TypeDesc typeByFilename(const std::string& filename)
+{
+    std::string extension = Strutil::lower(Filesystem::extension(filename, false));
+    if (extension == "png" || extension == "jpg" || extension == "jpeg" ||
+        extension == "tga" || extension == "bmp" || extension == "gif" || extension == "ppm") {
+        return TypeDesc::UINT8;
+    }
+    if (extension == "exr") {
+        return TypeDesc::HALF;
+    }
+    return TypeDesc::FLOAT;
+}
+
+// utils -- output
+bool writeByOutput(const ImageBuf& imagebuf, const std::string& filename, Filesystem::IOProxy* ioproxy)
+{
+    auto out = ImageOutput::create(filename, ioproxy);
+    if (!out) {
+        print_error("could not create output file: ", OIIO::geterror());
+        return false;
+    }
+    if (!out->open(filename, imagebuf.spec())) {
+        print_error("could not open output file: ", out->geterror());
+        return false;
+    }
+    if (!imagebuf.write(out.get())) {
+        print_error("could not write output file: ", imagebuf.geterror());
+        return false;
+    }
+    if (!out->close()) {
+        print_error("could not close output file: ", out->geterror());
+        return false;
+    }
+    return true;
+}
+
+// utils -- tiles
+std::vector<char> coverageByTiles(const DisplayList& displaylist, const SymmetryTool& symmetrytool)
+{
+    // tiles touched by primitives, from the sparse coverage of the display
+    // list and without a pass over the pixels
+    if (!symmetrytool.tiled) {
+        return std::vector<char>();
+    }
+    ROI roi(0, symmetrytool.size.x, 0, symmetrytool.size.y);
+    return dirtyTilesBy(DisplayList(), displaylist, roi, symmetrytool.tilesize);
+}
+
+bool writeByTiles(const ImageBuf& imagebuf, const std::string& filename, Filesystem::IOProxy* ioproxy, const std::vector<char>& coverage, int tilesize, bool verbose)
+{
+    auto out = ImageOutput::create(filename, ioproxy);
+    if (!out) {
+        print_error("could not create output file: ", OIIO::geterror());
+        return false;
+    }
+    if (!out->supports("tiles")) {
+        print_warning("tiles not supported, writing scanlines for format: ", out->format_name());
+        return writeByOutput(imagebuf, filename, ioproxy);
+    }
+    
+    ImageSpec spec = imagebuf.spec();
+    spec.tile_width = tilesize;
+    spec.tile_height = tilesize;
+    spec.tile_depth = 1;
+    spec.attribute("compression", "zip");
+    if (!out->open(filename, spec)) {
+        print_error("could not open output file: ", out->geterror());
+        return false;
+    }
+    
+    // exr and tiff readers expect every tile, empty tiles are still written
+    // but from a shared zero tile, skipping the gather and conversion, and
+    // compress down to a few bytes
+    stride_t xstride = spec.pixel_bytes();
+    stride_t ystride = xstride * tilesize;
+    std::vector<unsigned char> empty(ystride * tilesize, 0);
+    std::vector<unsigned char> tile(ystride * tilesize);
+    
+    int xtiles = (spec.width + tilesize - 1) / tilesize;
+    int empties = 0;
+    for (size_t i = 0; i < coverage.size(); i++) {
+        int x = spec.x + (i % xtiles) * tilesize;
+        int y = spec.y + (i / xtiles) * tilesize;
+        const unsigned char* data = empty.data();
+        if (coverage[i]) {
+            ROI roi(
+                x,
+                std::min(x + tilesize, spec.x + spec.width),
+                y,
+                std::min(y + tilesize, spec.y + spec.height)
+            );
+            imagebuf.get_pixels(roi, spec.format, tile.data(), xstride, ystride);
+            data = tile.data();
+        } else {
+            empties++;
+        }
+        if (!out->write_tile(x, y, 0, spec.format, data, xstride, ystride)) {
+            print_error("could not write tile: ", out->geterror());
+            return false;
+        }
+    }
+    if (verbose) {
+        print_info("Empty tiles written as zero tiles: ", empties);
+    }
+    if (!out->close()) {
+        print_error("could not close output file: ", out->geterror());
+        return false;
+    }
+    return true;
+}
+
+// utils -- png
+bool writeByPng(const ImageBuf& imagebuf, std::ostream& os, const PngOptions& options, bool verbose)
+{
+    const ImageSpec& spec = imagebuf.spec();
+    PngColorType colortype;
+    std::string error;
+    if (!writePng(
+            os,
+            (const unsigned char*)imagebuf.localpixels(),
+            spec.width,
+            spec.height,
+            imagebuf.scanline_stride(),
+            options,
+            &colortype,
+            error)) {
+        print_error("could not write png file: ", error);
+        return false;
+    }
+    if (verbose) {
+        const char* types[] = { "auto", "rgba", "gray alpha", "palette" };
+        print_info("Png color type: ", types[(int)colortype]);
+    }
+    return true;
+}
+
+// utils -- bitmap
+bool writeByBitmap(const ImageBuf& imagebuf, const std::string& filename, Filesystem::IOProxy* ioproxy, Imath::Vec3<float> color, bool verbose)
+{
+    // coverage from alpha as a single 1-bit channel, any coverage sets the
+    // bit. the tiff writer packs bits from uint8 only, the color is kept in
+    // the image description
+    const ImageSpec& spec = imagebuf.spec();
+    ImageSpec bitmapspec(spec.width, spec.height, 1, TypeDesc::UINT8);
+    bitmapspec.channelnames = { "Y" };
+    ImageBuf bitmap(bitmapspec);
+    std::vector<float> alpha(spec.width);
+    for (int y = 0; y < spec.height; y++) {
+        imagebuf.get_pixels(ROI(spec.x, spec.x + spec.width, spec.y + y, spec.y + y + 1, 0, 1, 3, 4), TypeDesc::FLOAT, alpha.data());
+        unsigned char* row = (unsigned char*)bitmap.pixeladdr(0, y);
+        for (int x = 0; x < spec.width; x++) {
+            row[x] = alpha[x] > 0.0f ? 255 : 0;
+        }
+    }
+    std::ostringstream oss;
+    oss << "symmetrytool color: "
+        << color.x
+        << ", "
+        << color.y
+        << ", "
+        << color.z;
+    
+    bitmap.specmod().attribute("oiio:BitsPerSample", 1);
+    bitmap.specmod().attribute("compression", "zip");
+    bitmap.specmod().attribute("ImageDescription", oss.str());
+    if (!writeByOutput(bitmap, filename, ioproxy)) {
+        return false;
+    }
+    if (verbose) {
+        print_info("Bitmap written as 1-bit: ", filename);
+    }
+    return true;
+}
+
+bool validMonochrome(const SymmetryTool& symmetrytool, std::string& error)
+{
+    // monochrome outputs are indexed by alpha and recolored with the color,
+    // every primitive must have that color
+    for (const Imath::Vec3<float>& color : symmetrytool.colors) {
+        if (color != symmetrytool.color) {
+            error = "monochrome output has a single color, --color list is not supported";
+            return false;
+        }
+    }
+    for (const auto& style : symmetrytool.styles) {
+        if (style.second.hascolor && (style.second.color != symmetrytool.color || symmetrytool.colorkeys.size())) {
+            error = "monochrome output has a single color, --style color is not supported for class: " + style.first;
+            return false;
+        }
+    }
+    return true;
+}
+
+// utils -- hash
+static const int bandheight = 256;
+
+uint64_t hashByRows(const ImageBuf& imagebuf, int ybegin, int yend)
+{
+    // native pixel bytes, rows are hashed while the band is in cache
+    const ImageSpec& spec = imagebuf.spec();
+    size_t rowbytes = (size_t)spec.width * spec.pixel_bytes();
+    PixelHash hash;
+    for (int y = ybegin; y < yend; y++) {
+        hash.update(imagebuf.pixeladdr(spec.x, y), rowbytes);
+    }
+    return hash.digest();
+}
+
+void renderByBands(ImageBuf& imagebuf, const DisplayList& displaylist, std::vector<uint64_t>& hashes)
+{
+    // bounds are computed once, bands only render the primitives crossing them
+    const ImageSpec& spec = imagebuf.spec();
+    DisplayBounds bounds = boundsBy(displaylist);
+    hashes.clear();
+    for (int y = 0; y < spec.height; y += bandheight) {
+        ROI roi(0, spec.width, y, std::min(spec.height, y + bandheight));
+        renderDisplayList(imagebuf, displaylist, bounds, roi);
+        hashes.push_back(hashByRows(imagebuf, roi.ybegin, roi.yend));
+    }
+}
+
+bool writeHash(const std::string& outputname, uint64_t hash, const SymmetryTool& symmetrytool)
+{
+    // sidecar in the layout of checksum files, hash and file name
+    print_info("Pixel hash: ", hashString(hash));
+    if (symmetrytool.outputfile == "-") {
+        return true;
+    }
+    std::ofstream os(outputname + ".hash");
+    os << hashString(hash) << "  " << Filesystem::filename(outputname) << std::endl;
+    if (!os) {
+        print_error("could not write hash file: ", outputname + ".hash");
+        return false;
+    }
+    return true;
+}
+
+void removeHash(const std::string& outputname, const SymmetryTool& symmetrytool)
+{
+    // the sidecar of an earlier run must not vouch for a failed write
+    if (symmetrytool.hash && symmetrytool.outputfile != "-") {
+        std::string error;
+        Filesystem::remove(outputname + ".hash", error);
+    }
+}
+
+// utils -- mask
+bool isMask(const std::string& outputname)
+{
+    return Strutil::lower(Filesystem::extension(outputname, false)) == "mask";
+}
+
+bool writeByMask(const DisplayList& displaylist, int width, int height, std::ostream& os, bool verbose, uint64_t* hash)
+{
+    TraceSpan span("mask", "encode");
+    const uint16_t order = 1;
+    if (*(const unsigned char*)&order != 1) {
+        print_error("coverage masks are little endian and can not be written on this host", "");
+        return false;
+    }
+    
+    // coverage is rasterized in bands into a single alpha channel and
+    // emitted as runs, the rgba image is never allocated
+    ImageSpec spec(width, std::min(height, bandheight), 1, TypeDesc::UINT8);
+    spec.channelnames = { "A" };
+    spec.alpha_channel = 0;
+    ImageBuf band(spec);
+    std::vector<uint64_t> rows = { 0 };
+    std::vector<symmetry_mask_span> spans;
+    std::vector<uint64_t> hashes;
+    DisplayBounds bounds = boundsBy(displaylist);
+    rows.reserve(height + 1);
+    for (int y = 0; y < height; y += bandheight) {
+        ROI roi(0, width, y, std::min(height, y + bandheight));
+        band.set_origin(0, y);
+        ImageBufAlgo::zero(band);
+        renderDisplayList(band, displaylist, bounds, roi);
+        if (hash) {
+            hashes.push_back(hashByRows(band, roi.ybegin, roi.yend));
+        }
+        for (int row = roi.ybegin; row < roi.yend; row++) {
+            const unsigned char* pixels = (const unsigned char*)band.localpixels() + (size_t)(row - y) * width;
+            for (int x = 0; x < width;) {
+                unsigned char coverage = pixels[x];
+                if (!coverage) {
+                    x++;
+                    continue;
+                }
+                int begin = x;
+                while (x < width && pixels[x] == coverage && x - begin < 65535) {
+                    x++;
+                }
+                spans.push_back({ (uint32_t)begin, (uint16_t)(x - begin), coverage, 0 });
+            }
+            rows.push_back(spans.size());
+        }
+    }
+    
+    symmetry_mask_header header;
+    std::memcpy(header.magic, SYMMETRY_MASK_MAGIC, 4);
+    header.version = SYMMETRY_MASK_VERSION;
+    header.width = width;
+    header.height = height;
+    header.spancount = spans.size();
+    os.write((const char*)&header, sizeof(header));
+    os.write((const char*)rows.data(), rows.size() * sizeof(uint64_t));
+    os.write((const char*)spans.data(), spans.size() * sizeof(symmetry_mask_span));
+    if (!os) {
+        print_error("could not write mask file", "");
+        return false;
+    }
+    if (verbose) {
+        print_info("Mask spans: ", spans.size());
+    }
+    if (hash) {
+        *hash = hashByBands(hashes, width, height, 1, 1);
+    }
+    return true;
+}
+
+bool writeByMask(const DisplayList& displaylist, const std::string& outputname, const SymmetryTool& symmetrytool)
+{
+    uint64_t hash = 0;
+    uint64_t* hashptr = symmetrytool.hash ? &hash : nullptr;
+    bool written = false;
+    if (symmetrytool.outputfile == "-") {
+        written = writeByMask(displaylist, symmetrytool.size.x, symmetrytool.size.y, std::cout, symmetrytool.verbose, hashptr);
+    } else {
+        std::ofstream os(outputname, std::ios::binary);
+        if (!os) {
+            print_error("could not open output file: ", outputname);
+            removeHash(outputname, symmetrytool);
+            return false;
+        }
+        written = writeByMask(displaylist, symmetrytool.size.x, symmetrytool.size.y, os, symmetrytool.verbose, hashptr);
+    }
+    if (written && symmetrytool.hash) {
+        written = writeHash(outputname, hash, symmetrytool);
+    } else if (!written) {
+        removeHash(outputname, symmetrytool);
+    }
+    return written;
+}
+
+// utils -- mapped
+bool isMapped(const SymmetryTool& symmetrytool, const std::string& outputname, TypeDesc datatype)
+{
+    // tiled, bitmap, sequence and stdout outputs are encoded and can not be
+    // mapped, windows writes by format
+#ifdef _WIN32
+    return false;
+#else
+    std::string extension = Filesystem::extension(outputname, false);
+    return symmetrytool.mmap && !symmetrytool.tiled && !symmetrytool.monochrome && !symmetrytool.sequence && symmetrytool.outputfile != "-" &&
+           isMappedFormat(extension, (int)datatype.size());
+#endif
+}
+
+std::unique_ptr<ImageBuf> imageBufByMapped(MappedFile& mapped, const std::string& outputname, const SymmetryTool& symmetrytool, TypeDesc datatype)
+{
+    // the image buffer wraps the pixel region of the mapped file and is
+    // rendered in place, the file is complete once unmapped
+    int nchannels = channelsByMappedFormat(Filesystem::extension(outputname, false));
+    std::string error;
+    if (!mapped.open(
+            outputname,
+            symmetrytool.size.x,
+            symmetrytool.size.y,
+            nchannels,
+            (int)datatype.size(),
+            datatype.is_floating_point(),
+            error)) {
+        print_error("could not map output file: ", error);
+        return nullptr;
+    }
+    ImageSpec spec(symmetrytool.size.x, symmetrytool.size.y, nchannels, datatype);
+    return std::unique_ptr<ImageBuf>(new ImageBuf(spec, mapped.pixels(), AutoStride, mapped.ystride()));
+}
+
+bool closeByMapped(MappedFile& mapped)
+{
+    TraceSpan span("unmap", "encode");
+    std::string error;
+    if (!mapped.close(error)) {
+        print_error("could not write mapped output file: ", error);
+        return false;
+    }
+    return true;
+}
+
+// utils -- overlay
+ImageBuf overlayBy(const DisplayList& displaylist, const DisplayBounds& bounds, ROI roi)
+{
+    // overlay is rendered over zero, float rgba
+    ImageSpec spec(roi.width(), roi.height(), 4, TypeDesc::FLOAT);
+    spec.x = roi.xbegin;
+    spec.y = roi.ybegin;
+    ImageBuf overlay(spec);
+    renderDisplayList(overlay, displaylist, bounds, roi);
+    return overlay;
+}
+
+void compositeBy(float* pixels, stride_t ystride, ROI roi, const ImageSpec& spec, const ImageBuf& overlay)
+{
+    // overlay composited over the plate, the same blend as rendering onto a
+    // plate with alpha, also for rgb plates
+    int colors = std::min(3, spec.nchannels);
+    for (int y = roi.ybegin; y < roi.yend; y++) {
+        float* row = (float*)((char*)pixels + (y - roi.ybegin) * ystride);
+        for (int x = roi.xbegin; x < roi.xend; x++) {
+            const float* o = (const float*)overlay.pixeladdr(x, y);
+            if (!o[0] && !o[1] && !o[2] && !o[3]) {
+                continue;
+            }
+            float* p = row + (x - roi.xbegin) * spec.nchannels;
+            float t = 1.0f - o[3];
+            for (int c = 0; c < colors; c++) {
+                if (c != spec.alpha_channel) {
+                    p[c] = o[c] + p[c] * t;
+                }
+            }
+            if (spec.alpha_channel >= 0) {
+                p[spec.alpha_channel] = o[3] + p[spec.alpha_channel] * t;
+            }
+        }
+    }
+}
+
+bool overlayByCache(const SymmetryTool& symmetrytool, const std::string& outputname)
+{
+    // the plate is read through the image cache one row of tiles at a time,
+    // tiles without primitives are copied through in the output format and
+    // only touched tiles are converted to float and composited
+    ImageCache* cache = ImageCache::create(true);
+    ustring inputname(symmetrytool.inputfile);
+    ImageSpec spec;
+    if (!cache->get_imagespec(inputname, spec)) {
+        print_error("could not read input file: ", cache->geterror());
+        return false;
+    }
+    SymmetryTool overlaytool = symmetrytool;
+    overlaytool.size = Imath::Vec2<int>(spec.width, spec.height);
+    DisplayList displaylist = displayListBy(overlaytool);
+    DisplayBounds bounds = boundsBy(displaylist);
+    
+    auto out = ImageOutput::create(outputname);
+    if (!out) {
+        print_error("could not create output file: ", OIIO::geterror());
+        return false;
+    }
+    bool tiled = out->supports("tiles");
+    int tilesize = spec.tile_width && spec.tile_width == spec.tile_height ? spec.tile_width : symmetrytool.tilesize;
+    ImageSpec outspec = spec;
+    outspec.channelformats.clear();
+    if (symmetrytool.datatype != TypeDesc::UNKNOWN) {
+        outspec.set_format(symmetrytool.datatype);
+    }
+    outspec.tile_width = tiled ? tilesize : 0;
+    outspec.tile_height = tiled ? tilesize : 0;
+    outspec.tile_depth = 1;
+    if (!out->open(outputname, outspec)) {
+        print_error("could not open output file: ", out->geterror());
+        return false;
+    }
+    
+    std::vector<char> touched = dirtyTilesBy(DisplayList(), displaylist, ROI(0, spec.width, 0, spec.height), tilesize);
+    int xtiles = (spec.width + tilesize - 1) / tilesize;
+    int ytiles = (spec.height + tilesize - 1) / tilesize;
+    int nchannels = spec.nchannels;
+    TypeDesc format = outspec.format;
+    size_t tilebytes = (size_t)tilesize * tilesize * nchannels * std::max(format.size(), sizeof(float));
+    std::vector<std::vector<unsigned char>> tiles(tiled ? xtiles : 0, std::vector<unsigned char>(tilebytes));
+    std::vector<float> band(tiled ? 0 : (size_t)spec.width * tilesize * nchannels);
+    std::atomic<bool> failed { false };
+    for (int ty = 0; ty < ytiles; ty++) {
+        int ybegin = ty * tilesize;
+        int yend = std::min(spec.height, ybegin + tilesize);
+        
+        // tiles of a row are read and composited in parallel and written in
+        // order, scanline outputs are written as float bands
+        parallel_for(0, xtiles, [&](int64_t tx) {
+            int xbegin = (int)tx * tilesize;
+            int xend = std::min(spec.width, xbegin + tilesize);
+            bool overlay = touched[ty * xtiles + tx] != 0;
+            TypeDesc type = overlay || !tiled ? TypeDesc::FLOAT : format;
+            stride_t xstride = nchannels * type.size();
+            stride_t ystride = tiled ? tilesize * xstride : spec.width * xstride;
+            void* pixels = tiled ? (void*)tiles[tx].data() : (void*)(band.data() + (size_t)xbegin * nchannels);
+            if (!cache->get_pixels(
+                    inputname,
+                    0,
+                    0,
+                    spec.x + xbegin,
+                    spec.x + xend,
+                    spec.y + ybegin,
+                    spec.y + yend,
+                    spec.z,
+                    spec.z + 1,
+                    0,
+                    nchannels,
+                    type,
+                    pixels,
+                    xstride,
+                    ystride)) {
+                failed = true;
+                return;
+            }
+            if (overlay) {
+                ROI roi(xbegin, xend, ybegin, yend);
+                compositeBy((float*)pixels, ystride, roi, spec, overlayBy(displaylist, bounds, roi));
+            }
+        });
+        if (failed) {
+            print_error("could not read input tiles: ", cache->geterror());
+            return false;
+        }
+        bool written = true;
+        if (tiled) {
+            for (int tx = 0; tx < xtiles && written; tx++) {
+                TypeDesc type = touched[ty * xtiles + tx] ? TypeDesc::FLOAT : format;
+                written = out->write_tile(
+                    spec.x + tx * tilesize,
+                    spec.y + ybegin,
+                    spec.z,
+                    type,
+                    tiles[tx].data(),
+                    nchannels * type.size(),
+                    tilesize * nchannels * type.size());
+            }
+        } else {
+            written = out->write_scanlines(spec.y + ybegin, spec.y + yend, spec.z, TypeDesc::FLOAT, band.data());
+        }
+        if (!written) {
+            print_error("could not write output file: ", out->geterror());
+            return false;
+        }
+    }
+    if (!out->close()) {
+        print_error("could not close output file: ", out->geterror());
+        return false;
+    }
+    if (symmetrytool.verbose) {
+        size_t composited = std::count(touched.begin(), touched.end(), 1);
+        print_info("Tiles composited: ", composited);
+        print_info("Tiles copied: ", touched.size() - composited);
+    }
+    return true;
+}
+
+// utils -- keyframes
+template <typename T>
+T valueByFrame(std::vector<std::pair<int, T>> keys, int frame, const T& value)
+{
+    if (!keys.size()) {
+        return value;
+    }
+    std::stable_sort(keys.begin(), keys.end(), [](const std::pair<int, T>& a, const std::pair<int, T>& b) {
+        return a.first < b.first;
+    });
+    if (frame <= keys.front().first) {
+        return keys.front().second;
+    }
+    for (size_t i = 1; i < keys.size(); i++) {
+        if (frame <= keys[i].first) {
+            float t = (float)(frame - keys[i - 1].first) / (keys[i].first - keys[i - 1].first);
+            return keys[i - 1].second + (keys[i].second - keys[i - 1].second) * t;
+        }
+    }
+    return keys.back().second;
+}
+
+std::string filenameByFrame(const std::string& filename, int frame)
+{
+    size_t begin = filename.find('#');
+    if (begin == std::string::npos) {
+        return filename;
+    }
+    size_t end = filename.find_first_not_of('#', begin);
+    if (end == std::string::npos) {
+        end = filename.size();
+    }
+    std::ostringstream oss;
+    oss << std::setw(end - begin) << std::setfill('0') << frame;
+    return filename.substr(0, begin) + oss.str() + filename.substr(end);
+}
+
+SymmetryTool symmetryByFrame(const SymmetryTool& symmetrytool, int frame)
+{
+    SymmetryTool frametool = symmetrytool;
+    frametool.aspectratio = valueByFrame(symmetrytool.aspectratiokeys, frame, symmetrytool.aspectratio);
+    frametool.scale = valueByFrame(symmetrytool.scalekeys, frame, symmetrytool.scale);
+    frametool.color = valueByFrame(symmetrytool.colorkeys, frame, symmetrytool.color);
+    return frametool;
+}
+
+bool writeSymmetry(const ImageBuf& imagebuf, const std::string& outputname, Filesystem::IOProxy* ioproxy, const SymmetryTool& symmetrytool, const std::vector<char>& coverage)
+{
+    TraceSpan span("encode", "encode");
+    // png is deflated in parallel row blocks when rendered as uint8 rgba
+    std::string extension = Strutil::lower(Filesystem::extension(outputname, false));
+    if (symmetrytool.tiled) {
+        return writeByTiles(imagebuf, outputname, ioproxy, coverage, symmetrytool.tilesize, symmetrytool.verbose);
+    } else if (extension == "png" && imagebuf.spec().format == TypeDesc::UINT8) {
+        PngOptions options;
+        options.compression = symmetrytool.compression;
+        options.monochrome = symmetrytool.monochrome;
+        for (int c = 0; c < 3; c++) {
+            options.color[c] = (unsigned char)std::round(std::min(std::max(symmetrytool.color[c], 0.0f), 1.0f) * 255);
+        }
+        if (ioproxy) {
+            return writeByPng(imagebuf, std::cout, options, symmetrytool.verbose);
+        } else {
+            std::ofstream os(outputname, std::ios::binary);
+            if (!os) {
+                print_error("could not open output file: ", outputname);
+                return false;
+            }
+            return writeByPng(imagebuf, os, options, symmetrytool.verbose);
+        }
+    } else if ((extension == "tif" || extension == "tiff") && symmetrytool.monochrome) {
+        return writeByBitmap(imagebuf, outputname, ioproxy, symmetrytool.color, symmetrytool.verbose);
+    } else {
+        return writeByOutput(imagebuf, outputname, ioproxy);
+    }
+}
+
+bool renderSequence(const SymmetryTool& symmetrytool, TypeDesc datatype)
+{
+    // coverage masks are rasterized in bands per frame
+    if (isMask(symmetrytool.outputfile)) {
+        bool written = true;
+        Arena arena;
+        for (int frame = symmetrytool.frames.x; frame <= symmetrytool.frames.y; frame++) {
+            arena.reset();
+            ArenaScope scope(&arena);
+            SymmetryTool frametool = symmetryByFrame(symmetrytool, frame);
+            written &= writeByMask(displayListBy(frametool), filenameByFrame(symmetrytool.outputfile, frame), frametool);
+        }
+        return written;
+    }
+    
+    ImageSpec spec(symmetrytool.size.x, symmetrytool.size.y, 4, datatype);
+    spec.attribute("png:compressionLevel", symmetrytool.compression);
+    ImageBuf imagebuf(spec);
+    
+    // sequence, frames after the first re-render only the tiles touched by
+    // changed primitives and are encoded while the next frame renders
+    bool written = true;
+    Arena arenas[2];
+    DisplayList previous;
+    std::vector<uint64_t> hashes;
+    std::deque<std::future<bool>> encodes;
+    size_t maxencodes = std::max(2u, std::thread::hardware_concurrency() / 2);
+    for (int frame = symmetrytool.frames.x; frame <= symmetrytool.frames.y; frame++) {
+        // frames alternate between two arenas, the display list of the
+        // previous frame is kept while the next is generated
+        Arena& arena = arenas[(frame - symmetrytool.frames.x) % 2];
+        arena.reset();
+        ArenaScope scope(&arena);
+        SymmetryTool frametool = symmetryByFrame(symmetrytool, frame);
+        DisplayList displaylist = displayListBy(frametool);
+        if (frame == symmetrytool.frames.x) {
+            if (symmetrytool.hash) {
+                renderByBands(imagebuf, displaylist, hashes);
+            } else {
+                renderDisplayList(imagebuf, displaylist);
+            }
+        } else {
+            TraceSpan span("dirty tiles", "render");
+            std::vector<char> tiles = dirtyTilesBy(previous, displaylist, imagebuf.roi(), symmetrytool.tilesize);
+            renderByTiles(imagebuf, displaylist, tiles, symmetrytool.tilesize);
+            if (symmetrytool.verbose) {
+                print_info("Dirty tiles: ", std::count(tiles.begin(), tiles.end(), 1));
+            }
+            
+            // only bands with dirty tiles are hashed again
+            if (symmetrytool.hash) {
+                int tilesize = symmetrytool.tilesize;
+                int xtiles = (symmetrytool.size.x + tilesize - 1) / tilesize;
+                for (size_t band = 0; band < hashes.size(); band++) {
+                    int ybegin = (int)band * bandheight;
+                    int yend = std::min(symmetrytool.size.y, ybegin + bandheight);
+                    bool dirty = false;
+                    for (int ty = ybegin / tilesize; ty <= (yend - 1) / tilesize && !dirty; ty++) {
+                        dirty = std::any_of(tiles.begin() + ty * xtiles, tiles.begin() + (ty + 1) * xtiles, [](char tile) {
+                            return tile != 0;
+                        });
+                    }
+                    if (dirty) {
+                        hashes[band] = hashByRows(imagebuf, ybegin, yend);
+                    }
+                }
+            }
+        }
+        std::vector<char> coverage = coverageByTiles(displaylist, frametool);
+        previous = std::move(displaylist);
+        
+        std::string framename = filenameByFrame(symmetrytool.outputfile, frame);
+        uint64_t hash = symmetrytool.hash ? hashByBands(hashes, spec.width, spec.height, spec.nchannels, (int)spec.format.size()) : 0;
+        if (symmetrytool.verbose) {
+            print_info("Writing frame: ", framename);
+        }
+        if (encodes.size() >= maxencodes) {
+            written &= encodes.front().get();
+            encodes.pop_front();
+        }
+        std::shared_ptr<ImageBuf> framebuf = std::make_shared<ImageBuf>(imagebuf);
+        encodes.push_back(std::async(std::launch::async, [framebuf, framename, frametool, coverage, hash]() {
+            // the sidecar is written once the frame is
+            bool written = writeSymmetry(*framebuf, framename, nullptr, frametool, coverage);
+            if (written && frametool.hash) {
+                written = writeHash(framename, hash, frametool);
+            } else if (!written) {
+                removeHash(framename, frametool);
+            }
+            return written;
+        }));
+    }
+    for (std::future<bool>& encode : encodes) {
+        written &= encode.get();
+    }
+    return written;
+}
+
+// utils -- pipeline
+template <typename T>
+class PipelineQueue
+{
+public:
+    explicit PipelineQueue(size_t capacity)
+    : capacity(capacity)
+    {}
+    
+    // blocks while full, a slow stage holds back the stages before it
+    void push(T value)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        notfull.wait(lock, [this]() { return values.size() < capacity; });
+        values.push_back(std::move(value));
+        notempty.notify_one();
+    }
+    
+    // blocks while empty, false when closed and drained
+    bool pop(T& value)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        notempty.wait(lock, [this]() { return values.size() || closed; });
+        if (!values.size()) {
+            return false;
+        }
+        value = std::move(values.front());
+        values.pop_front();
+        notfull.notify_one();
+        return true;
+    }
+    
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        notempty.notify_all();
+    }
+    
+private:
+    size_t capacity;
+    bool closed = false;
+    std::deque<T> values;
+    std::mutex mutex;
+    std::condition_variable notfull;
+    std::condition_variable notempty;
 };
 
-static SymmetryTool tool;
+struct PipelineStage
+{
+    const char* name;
+    int threads;
+    std::atomic<int64_t> busy { 0 }; // microseconds
+    
+    void add(double seconds) { busy += (int64_t)(seconds * 1e6); }
+    double utilization(double seconds) const { return busy / (seconds * 1e6 * threads); }
+};
 
-static int
-set_outputfile(int argc, const char* argv[])
+struct PipelineFrame
 {
-    OIIO_DASSERT(argc == 2);
-    tool.outputfile = argv[1];
-    return 0;
-}
+    int frame = 0;
+    TypeDesc format;
+    std::unique_ptr<ImageBuf> imagebuf;
+};
 
-// --aspectratio
-static int
-set_aspectratio(int argc, const char* argv[])
+bool overlaySequence(const SymmetryTool& symmetrytool)
 {
-    OIIO_DASSERT(argc == 2);
-    std::istringstream iss(argv[1]);
-    iss >> tool.aspectratio;
-    if (iss.fail()) {
-        print_error("could not parse aspect ratio from string: ", argv[1]);
-        return 1;
-    } else {
-        return 0;
+    // frames are decoded, composited and encoded by separate stages joined
+    // by bounded queues, decode runs ahead of composite by at most the queue
+    // capacity and encode holds back composite the same way. every thread
+    // holds a float frame, frames in flight are bounded by the threads and
+    // the queue capacity independent of the core count
+    int cores = std::max(2u, std::thread::hardware_concurrency());
+    PipelineStage decode { "decode", std::min(std::max(1, cores / 2), 4) };
+    PipelineStage composite { "composite", 1 };
+    PipelineStage encode { "encode", std::min(std::max(1, cores / 2), 4) };
+    size_t capacity = 2;
+    PipelineQueue<PipelineFrame> decoded(capacity);
+    PipelineQueue<PipelineFrame> composited(capacity);
+    std::atomic<int> next { symmetrytool.frames.x };
+    std::atomic<int> decoders { decode.threads };
+    std::atomic<bool> failed { false };
+    Timer timer;
+    
+    std::vector<std::thread> threads;
+    for (int i = 0; i < decode.threads; i++) {
+        threads.emplace_back([&]() {
+            for (int frame = next++; frame <= symmetrytool.frames.y && !failed; frame = next++) {
+                TraceSpan span("decode frame", "pipeline");
+                Timer busy;
+                std::string inputname = filenameByFrame(symmetrytool.inputfile, frame);
+                PipelineFrame decodedframe;
+                decodedframe.frame = frame;
+                decodedframe.imagebuf.reset(new ImageBuf(inputname));
+                if (!decodedframe.imagebuf->read(0, 0, true, TypeDesc::FLOAT)) {
+                    print_error("could not read input file: ", decodedframe.imagebuf->geterror());
+                    failed = true;
+                    break;
+                }
+                decodedframe.format = symmetrytool.datatype != TypeDesc::UNKNOWN ? symmetrytool.datatype : decodedframe.imagebuf->nativespec().format;
+                decode.add(busy());
+                decoded.push(std::move(decodedframe));
+            }
+            if (--decoders == 0) {
+                decoded.close();
+            }
+        });
+    }
+    
+    // the overlay is rendered once and only again when keyframes change the
+    // display list or the plate size changes, frames may arrive out of order
+    int rendered = 0;
+    threads.emplace_back([&]() {
+        Arena arenas[2];
+        int scratch = 0;
+        DisplayList cached;
+        Imath::Vec2<int> size;
+        std::vector<ROI> tiles;
+        std::vector<ImageBuf> overlays;
+        PipelineFrame frame;
+        while (decoded.pop(frame)) {
+            TraceSpan span("composite frame", "pipeline");
+            Timer busy;
+            const ImageSpec& spec = frame.imagebuf->spec();
+            SymmetryTool frametool = symmetryByFrame(symmetrytool, frame.frame);
+            frametool.size = Imath::Vec2<int>(spec.width, spec.height);
+            
+            // the cached display list keeps its arena, the other is rewound
+            // for every frame
+            arenas[scratch].reset();
+            ArenaScope scope(&arenas[scratch]);
+            DisplayList displaylist = displayListBy(frametool);
+            ROI roi(0, spec.width, 0, spec.height);
+            if (!rendered || displaylist != cached || size != Imath::Vec2<int>(spec.width, spec.height)) {
+                // overlays of the touched tiles only, the plate is not
+                // covered by a frame sized overlay
+                int tilesize = symmetrytool.tilesize;
+                int xtiles = (spec.width + tilesize - 1) / tilesize;
+                std::vector<char> touched = dirtyTilesBy(DisplayList(), displaylist, roi, tilesize);
+                tiles.clear();
+                for (size_t i = 0; i < touched.size(); i++) {
+                    if (touched[i]) {
+                        int xbegin = (int)(i % xtiles) * tilesize;
+                        int ybegin = (int)(i / xtiles) * tilesize;
+                        tiles.emplace_back(xbegin, std::min(spec.width, xbegin + tilesize), ybegin, std::min(spec.height, ybegin + tilesize));
+                    }
+                }
+                overlays.resize(tiles.size());
+                DisplayBounds bounds = boundsBy(displaylist);
+                parallel_for(0, (int64_t)tiles.size(), [&](int64_t i) {
+                    overlays[i] = overlayBy(displaylist, bounds, tiles[i]);
+                });
+                size = Imath::Vec2<int>(spec.width, spec.height);
+                cached = std::move(displaylist);
+                scratch = 1 - scratch;
+                rendered++;
+            }
+            ImageBuf& imagebuf = *frame.imagebuf;
+            parallel_for(0, (int64_t)tiles.size(), [&](int64_t i) {
+                const ROI& tile = tiles[i];
+                float* pixels = (float*)imagebuf.pixeladdr(spec.x + tile.xbegin, spec.y + tile.ybegin);
+                compositeBy(pixels, imagebuf.scanline_stride(), tile, spec, overlays[i]);
+            });
+            composite.add(busy());
+            composited.push(std::move(frame));
+        }
+        composited.close();
+    });
+    
+    for (int i = 0; i < encode.threads; i++) {
+        threads.emplace_back([&]() {
+            PipelineFrame frame;
+            while (composited.pop(frame)) {
+                TraceSpan span("encode frame", "pipeline");
+                Timer busy;
+                std::string framename = filenameByFrame(symmetrytool.outputfile, frame.frame);
+                if (!frame.imagebuf->write(framename, frame.format)) {
+                    print_error("could not write output file: ", frame.imagebuf->geterror());
+                    failed = true;
+                } else if (symmetrytool.verbose) {
+                    print_info("Writing frame: ", framename);
+                }
+                encode.add(busy());
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    
+    if (symmetrytool.verbose) {
+        double seconds = timer();
+        int frames = symmetrytool.frames.y - symmetrytool.frames.x + 1;
+        print_info("Overlays rendered: ", rendered);
+        print_info("Frames per second: ", frames / seconds);
+        for (const PipelineStage* stage : { &decode, &composite, &encode }) {
+            print_info(Strutil::sprintf("Stage %s utilization: ", stage->name),
+                Strutil::sprintf("%.0f%% of %d threads", stage->utilization(seconds) * 100, stage->threads));
+        }
     }
+    return !failed;
 }
 
-// --scale
-static int
-set_scale(int argc, const char* argv[])
+bool validOverlay(const SymmetryTool& symmetrytool, std::string& error)
 {
-    OIIO_DASSERT(argc == 2);
-    std::istringstream iss(argv[1]);
-    iss >> tool.scale;
-    if (iss.fail()) {
-        print_error("could not parse scale from string: ", argv[1]);
-        return 1;
-    } else {
-        return 0;
+    // the plate is composited by tiles and written in its own layout, the
+    // options of rendered outputs do not apply
+    if (symmetrytool.outputfile == "-" || isMask(symmetrytool.outputfile)) {
+        error = "input overlay must be written to an image file: " + symmetrytool.outputfile;
+    } else if (symmetrytool.hash) {
+        error = "input overlay can not be hashed, --hash is not supported";
+    } else if (symmetrytool.tiled) {
+        error = "input overlay keeps the tiles of the plate, --tiled is not supported";
+    } else if (symmetrytool.monochrome) {
+        error = "input overlay is written in color, --monochrome is not supported";
+    } else if (symmetrytool.mmap) {
+        error = "input overlay can not be memory mapped, --mmap is not supported";
     }
+    return error.empty();
 }
 
-// --color
-static int
-set_color(int argc, const char* argv[])
+bool overlaySymmetry(const SymmetryTool& symmetrytool)
 {
-    OIIO_DASSERT(argc == 2);
-    std::istringstream iss(argv[1]);
-    iss >> tool.color.x;
-    iss.ignore(); // Ignore the comma
-    iss >> tool.color.y;
-    iss.ignore(); // Ignore the comma
-    iss >> tool.color.z;
-    if (iss.fail()) {
-        print_error("could not parse color from string: ", argv[1]);
-        return 1;
-    } else {
-        return 0;
-    }
+    return symmetrytool.sequence ? overlaySequence(symmetrytool) : overlayByCache(symmetrytool, symmetrytool.outputfile);
 }
 
-// --size
-static int
-set_size(int argc, const char* argv[])
+// job scheduler
+struct SymmetryJob
 {
-    OIIO_DASSERT(argc == 2);
-    std::istringstream iss(argv[1]);
-    iss >> tool.size.x;
-    iss.ignore(); // Ignore the comma
-    iss >> tool.size.y;
-    if (iss.fail()) {
-        print_error("could not parse size from string: ", argv[1]);
-        return 1;
-    } else {
-        return 0;
-    }
-}
+    SymmetryTool tool;
+    TypeDesc datatype;
+    double cost = 0.0;
+    std::unique_ptr<Arena> arena;
+    DisplayList displaylist;
+    DisplayBounds bounds;
+    std::unique_ptr<ImageBuf> imagebuf;
+    std::unique_ptr<MappedFile> mapped;
+    std::vector<uint64_t> hashes;
+    std::atomic<int> bands { 0 };
+    bool written = false;
+};
 
-// --help
-static void
-print_help(ArgParse& ap)
+enum class SymmetryStage
 {
-    ap.print_help();
-}
+    Geometry,
+    Raster,
+    Encode,
+    Sequence,
+    Overlay
+};
 
-// utils
-void renderBoxByThickness(ImageBuf& imagebuf, ROI roi, Imath::Vec3<float> color, int thickness) {
-
-    for (int t=0; t<thickness; t++) {
-        ImageBufAlgo::render_box(
-            imagebuf, roi.xbegin + t, roi.ybegin + t, roi.xend - t - 1, roi.yend - t - 1,
-            { color.x, color.y, color.z, 1.0f }
-        );
-        ImageBufAlgo::render_box(
-            imagebuf, roi.xbegin - t, roi.ybegin - t, roi.xend + t - 1, roi.yend + t - 1,
-            { color.x, color.y, color.z, 1.0f }
-        );
-    }
-}
-
-void renderLineByPattern(ImageBuf& imagebuf, ROI roi, Imath::Vec3<float> color, int dot_interval) {
-
-    float length = std::sqrt(std::pow(roi.xend - roi.xbegin, 2) + std::pow(roi.yend - roi.ybegin, 2));
-    int dots = std::round(length / dot_interval);
-    for (int i = 0; i < dots; ++i) {
-        if (i % 2 == 0) {
-            float start = static_cast<float>(i) / dots;
-            float end = static_cast<float>(i + 1) / dots;
-            int xbegin = roi.xbegin + std::round((roi.xend - roi.xbegin) * start);
-            int ybegin = roi.ybegin + std::round((roi.yend - roi.ybegin) * start);
-            int xend = roi.xbegin + std::round((roi.xend - roi.xbegin) * end);
-            int yend = roi.ybegin + std::round((roi.yend - roi.ybegin) * end);
-
-            ImageBufAlgo::render_line(
-                imagebuf,
-                xbegin,
-                ybegin,
-                xend,
-                yend,
-                { color.x, color.y, color.z, 1.0f }
-            );
+struct SymmetryTask
+{
+    size_t job;
+    SymmetryStage stage;
+    int band = 0;
+    double cost = 0.0;
+    
+    bool operator<(const SymmetryTask& other) const
+    {
+        // priority queue pops the largest, cheapest job runs first
+        if (cost != other.cost) {
+            return cost > other.cost;
         }
+        return job > other.job;
     }
-}
+};
 
-// utils -- region of interest
-ROI scaleBy(ROI roi, float sx, float sy)
+class SymmetryScheduler
 {
-    int cx = (roi.xbegin + roi.xend) / 2;
-    int cy = (roi.ybegin + roi.yend) / 2;
-
-    int width = roi.width();
-    int height = roi.height();
-    int swidth = width * sx;
-    int sheight = height * sy;
+public:
+    SymmetryScheduler(std::vector<std::unique_ptr<SymmetryJob>>& jobs, int workers)
+    : jobs(jobs)
+    , workers(workers)
+    , maxactive(workers * 2)
+    {}
+    
+    void run()
+    {
+        // jobs are admitted cheapest first with a bound on active jobs to
+        // limit memory, admitted jobs interleave their raster bands and
+        // encodes ahead of more expensive jobs
+        for (size_t i = 0; i < jobs.size(); i++) {
+            SymmetryTask task;
+            task.job = i;
+            task.stage = SymmetryStage::Geometry;
+            if (jobs[i]->tool.inputfile.size()) {
+                task.stage = SymmetryStage::Overlay;
+            } else if (jobs[i]->tool.sequence) {
+                task.stage = SymmetryStage::Sequence;
+            }
+            task.cost = jobs[i]->cost;
+            admissions.push(task);
+        }
+        std::vector<std::thread> threads;
+        for (int i = 0; i < workers; i++) {
+            threads.push_back(std::thread([this]() { work(); }));
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
 
-    int dx = (swidth - width) / 2;
-    int dy = (sheight - height) / 2;
+private:
+    void work()
+    {
+        while (true) {
+            SymmetryTask task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [this]() {
+                    return tasks.size() || (admissions.size() && active < maxactive) || (!admissions.size() && !active);
+                });
+                bool admit = admissions.size() && active < maxactive &&
+                             (!tasks.size() || admissions.top().cost < tasks.top().cost);
+                if (admit) {
+                    task = admissions.top();
+                    admissions.pop();
+                    active++;
+                } else if (tasks.size()) {
+                    task = tasks.top();
+                    tasks.pop();
+                } else {
+                    condition.notify_all();
+                    return;
+                }
+            }
+            execute(task);
+        }
+    }
     
-    ROI sroi = roi;
+    void push(const SymmetryTask& task)
     {
-        sroi.xbegin -= dx;
-        sroi.xend = sroi.xbegin + swidth;
-        sroi.ybegin -= dy;
-        sroi.yend = sroi.ybegin + sheight;
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push(task);
+        condition.notify_one();
     }
-    return sroi;
-}
+    
+    void finish()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        active--;
+        condition.notify_all();
+    }
+    
+    // arenas are rewound when a job is done and handed to the next job
+    std::unique_ptr<Arena> acquire()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!arenas.size()) {
+            return std::unique_ptr<Arena>(new Arena());
+        }
+        std::unique_ptr<Arena> arena = std::move(arenas.back());
+        arenas.pop_back();
+        return arena;
+    }
+    
+    void release(std::unique_ptr<Arena> arena)
+    {
+        arena->reset();
+        std::lock_guard<std::mutex> lock(mutex);
+        arenas.push_back(std::move(arena));
+    }
+    
+    void execute(const SymmetryTask& task)
+    {
+        static const char* stages[] = { "geometry task", "raster task", "encode task", "sequence task", "overlay task" };
+        TraceSpan span(stages[(int)task.stage], "scheduler");
+        SymmetryJob& job = *jobs[task.job];
+        const SymmetryTool& tool = job.tool;
+        switch (task.stage) {
+            case SymmetryStage::Geometry: {
+                job.arena = acquire();
+                ArenaScope scope(job.arena.get());
+                if (isMask(tool.outputfile)) {
+                    job.written = writeByMask(displayListBy(tool), tool.outputfile, tool);
+                    release(std::move(job.arena));
+                    finish();
+                    break;
+                }
+                if (isMapped(tool, tool.outputfile, job.datatype)) {
+                    job.mapped.reset(new MappedFile());
+                    job.imagebuf = imageBufByMapped(*job.mapped, tool.outputfile, tool, job.datatype);
+                    if (!job.imagebuf) {
+                        job.mapped.reset();
+                        release(std::move(job.arena));
+                        finish();
+                        break;
+                    }
+                } else {
+                    ImageSpec spec(tool.size.x, tool.size.y, 4, job.datatype);
+                    spec.attribute("png:compressionLevel", tool.compression);
+                    job.imagebuf.reset(new ImageBuf(spec));
+                }
+                job.displaylist = displayListBy(tool);
+                job.bounds = boundsBy(job.displaylist);
+                
+                int bands = (tool.size.y + bandheight - 1) / bandheight;
+                job.hashes.assign(tool.hash ? bands : 0, 0);
+                job.bands = bands;
+                for (int band = 0; band < bands; band++) {
+                    SymmetryTask raster = task;
+                    raster.stage = SymmetryStage::Raster;
+                    raster.band = band;
+                    push(raster);
+                }
+                break;
+            }
+            case SymmetryStage::Raster: {
+                ROI roi(
+                    0,
+                    tool.size.x,
+                    task.band * bandheight,
+                    std::min(tool.size.y, (task.band + 1) * bandheight)
+                );
+                renderDisplayList(*job.imagebuf, job.displaylist, job.bounds, roi);
+                if (tool.hash) {
+                    job.hashes[task.band] = hashByRows(*job.imagebuf, roi.ybegin, roi.yend);
+                }
+                if (--job.bands == 0) {
+                    SymmetryTask encode = task;
+                    encode.stage = SymmetryStage::Encode;
+                    push(encode);
+                }
+                break;
+            }
+            case SymmetryStage::Encode: {
+                // the sidecar is written once the image is
+                const ImageSpec& spec = job.imagebuf->spec();
+                uint64_t hash = hashByBands(job.hashes, spec.width, spec.height, spec.nchannels, (int)spec.format.size());
+                if (job.mapped) {
+                    job.imagebuf.reset();
+                    job.written = closeByMapped(*job.mapped);
+                    job.mapped.reset();
+                } else {
+                    job.written = writeSymmetry(*job.imagebuf, tool.outputfile, nullptr, tool, coverageByTiles(job.displaylist, tool));
+                }
+                if (job.written && tool.hash) {
+                    job.written = writeHash(tool.outputfile, hash, tool);
+                } else if (!job.written) {
+                    removeHash(tool.outputfile, tool);
+                }
+                job.imagebuf.reset();
+                job.displaylist = DisplayList();
+                job.bounds = DisplayBounds();
+                release(std::move(job.arena));
+                finish();
+                break;
+            }
+            case SymmetryStage::Sequence: {
+                job.written = renderSequence(tool, job.datatype);
+                finish();
+                break;
+            }
+            case SymmetryStage::Overlay: {
+                job.written = overlaySymmetry(tool);
+                finish();
+                break;
+            }
+        }
+    }
+    
+    std::vector<std::unique_ptr<SymmetryJob>>& jobs;
+    int workers;
+    int maxactive;
+    int active = 0;
+    std::priority_queue<SymmetryTask> admissions;
+    std::priority_queue<SymmetryTask> tasks;
+    std::vector<std::unique_ptr<Arena>> arenas;
+    std::mutex mutex;
+    std::condition_variable condition;
+};
 
-ROI aspectRatioBy(ROI roi, float aspectRatio)
+std::vector<std::string> argumentsBy(const std::string& line)
 {
-    float ar = (float)roi.width() / roi.height();
-    if (ar != aspectRatio)
-    {
-        int awidth, aheight;
-        int hdiff = 0;
-        
-        if (ar < aspectRatio) {
-            aheight = (int)(roi.width() / aspectRatio);
-            hdiff = aheight - roi.height();
+    // words split by whitespace, double or single quotes keep a value with
+    // spaces or semicolons as one word
+    std::vector<std::string> words;
+    std::string word;
+    bool inword = false;
+    char quote = 0;
+    for (char c : line) {
+        if (quote) {
+            if (c == quote) {
+                quote = 0;
+            } else {
+                word += c;
+            }
+        } else if (c == '"' || c == '\'') {
+            quote = c;
+            inword = true;
+        } else if (std::isspace((unsigned char)c)) {
+            if (inword) {
+                words.push_back(word);
+                word.clear();
+                inword = false;
+            }
         } else {
-            aheight = (int)(roi.width() / aspectRatio);
-            hdiff = aheight - roi.height();
+            word += c;
+            inword = true;
         }
-        
-        int cx = roi.xbegin + roi.width() / 2;
-        int cy = roi.ybegin + roi.height() / 2;
+    }
+    if (inword) {
+        words.push_back(word);
+    }
+    return words;
+}
 
-        ROI arroi = roi;
-        {
-            arroi.xbegin = cx - arroi.width() / 2;
-            arroi.xend = arroi.xbegin + arroi.width();
-            arroi.ybegin = cy - arroi.height() / 2 - hdiff / 2;
-            arroi.yend = arroi.ybegin + aheight;
+bool jobsByFile(ArgParse& ap, const std::string& filename, std::vector<std::unique_ptr<SymmetryJob>>& jobs)
+{
+    TraceSpan span("parse job file", "startup");
+    std::string text;
+    if (!Filesystem::read_text_file(filename, text)) {
+        print_error("could not read job file: ", filename);
+        return false;
+    }
+    
+    // each line holds the arguments of one chart, on top of the arguments
+    // given on the command line
+    SymmetryTool base = tool;
+    base.jobfile.clear();
+    ap.exit_on_error(false);
+    int line = 0;
+    for (const std::string& jobline : Strutil::splits(text, "\n")) {
+        line++;
+        std::string args = std::string(Strutil::strip(jobline));
+        if (!args.size() || args[0] == '#') {
+            continue;
+        }
+        std::vector<std::string> words = argumentsBy(args);
+        std::vector<const char*> argv = { "symmetrytool" };
+        for (const std::string& word : words) {
+            argv.push_back(word.c_str());
         }
-        return arroi;
+        tool = base;
+        if (ap.parse_args((int)argv.size(), argv.data()) < 0) {
+            print_error(Strutil::sprintf("could not parse job file line %d: ", line), ap.geterror());
+            return false;
+        }
+        if (tool.code != EXIT_SUCCESS) {
+            print_error("could not parse job file line: ", line);
+            return false;
+        }
+        if (!tool.outputfile.size() || tool.outputfile == "-" || tool.jobfile.size()) {
+            print_error("job must have an output file, line: ", line);
+            return false;
+        }
+        if (tool.sequence && tool.outputfile.find('#') == std::string::npos) {
+            print_error("sequence output file must have a #### frame pattern, line: ", line);
+            return false;
+        }
+        if (tool.stmap.size() && !stmapBy(tool.stmap)) {
+            print_error("could not read st map, line: ", line);
+            return false;
+        }
+        std::string error;
+        if (tool.inputfile.size() && !validOverlay(tool, error)) {
+            print_error(error + ", line: ", line);
+            return false;
+        }
+        if (tool.monochrome && !validMonochrome(tool, error)) {
+            print_error(error + ", line: ", line);
+            return false;
+        }
+        std::unique_ptr<SymmetryJob> job(new SymmetryJob());
+        job->tool = tool;
+        job->datatype = tool.datatype != TypeDesc::UNKNOWN ? tool.datatype : typeByFilename(tool.outputfile);
+        job->cost = (double)tool.size.x * tool.size.y;
+        if (tool.sequence) {
+            job->cost *= tool.frames.y - tool.frames.x + 1;
+        }
+        jobs.push_back(std::move(job));
     }
-    return roi;
+    tool = base;
+    return true;
 }
 
-// utils -- trigonometry
-float radiansBy90()
+// utils -- stats
+double peakMemoryBy()
 {
-    return M_PI / 2.0;
+    // peak resident memory in megabytes, max rss is in bytes on macos
+#ifdef _WIN32
+    return Sysutil::memory_used(true) / (1024.0 * 1024.0);
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#    ifdef __APPLE__
+    return usage.ru_maxrss / (1024.0 * 1024.0);
+#    else
+    return usage.ru_maxrss / 1024.0;
+#    endif
+#endif
 }
 
-float degreesByRadians(float radians)
+bool statsBy(const SymmetryTool& symmetrytool, double seconds)
 {
-    return radians * 180.0f / M_PI;
+    double peak = peakMemoryBy();
+    if (symmetrytool.stats) {
+        print_info("Stats seconds: ", seconds);
+        print_info("Stats peak memory MB: ", peak);
+        ArenaStats arena = arenaStats();
+        print_info("Stats arena allocations: ", arena.allocations);
+        print_info("Stats arena MB: ", arena.bytes / (1024.0 * 1024.0));
+        print_info("Stats arena chunks: ", arena.chunks);
+        print_info("Stats arena resets: ", arena.resets);
+        print_info("Stats heap allocations: ", arena.heap);
+    }
+    bool within = true;
+    if (symmetrytool.budget.x > 0.0f && seconds > symmetrytool.budget.x) {
+        print_error("time budget exceeded, seconds: ", Strutil::sprintf("%g > %g", seconds, symmetrytool.budget.x));
+        within = false;
+    }
+    if (symmetrytool.budget.y > 0.0f && peak > symmetrytool.budget.y) {
+        print_error("memory budget exceeded, MB: ", Strutil::sprintf("%g > %g", peak, symmetrytool.budget.y));
+        within = false;
+    }
+    return within;
 }
 
+// utils -- trace
+struct TraceWriter
+{
+    // written when main returns, on success and failure
+    std::string filename;
+    
+    ~TraceWriter()
+    {
+        std::string error;
+        if (filename.size() && !writeTrace(filename, error)) {
+            print_error("could not write trace: ", error);
+        }
+    }
+};
+
 // main
 int 
 main( int argc, const char * argv[])
 {
-    // Helpful for debugging to make sure that any crashes dump a stack
-    // trace.
-    Sysutil::setup_crash_stacktrace("stdout");
-
+    Timer startup;
     Filesystem::convert_native_arguments(argc, (const char**)argv);
+    
+    // trace is enabled ahead of parsing so argument parsing is recorded
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--trace") {
+            enableTrace();
+        }
+    }
+    TraceWriter tracewriter;
+    
+    std::unique_ptr<TraceSpan> parsespan(new TraceSpan("parse arguments", "startup"));
     ArgParse ap;
 
     ap.intro("symmetrytool -- a utility for creating symmetry images\n");
@@ -279,13 +2052,51 @@ main( int argc, const char * argv[])
     ap.arg("-d", &tool.debug)
       .help("Debug status messages");
     
+    ap.arg("--jobfile %s:JOBFILE", &tool.jobfile)
+      .help("Render charts from job file, one line of arguments per chart");
+    
+    ap.arg("--trace %s:TRACE", &tool.trace)
+      .help("Write spans as chrome trace event json, e.g trace.json");
+    
+    ap.arg("--hash", &tool.hash)
+      .help("Print xxh64 hash of rendered pixels and write it to a .hash sidecar");
+    
+    ap.arg("--stats", &tool.stats)
+      .help("Print elapsed seconds by phase and peak memory");
+    
+    ap.arg("--budget %s:BUDGET")
+      .help("Fail when elapsed seconds or peak memory in MB exceed budget, e.g 2.0,512")
+      .action(set_budget);
+    
+    ap.arg("--pick %s:PICK")
+      .help("Print the primitive nearest to pixel position, e.g 512,512")
+      .action(set_pick);
+    
     ap.separator("Input flags:");
+    ap.arg("--inputfile %s:INPUTFILE", &tool.inputfile)
+      .help("Overlay symmetry on input image, only tiles with primitives are composited");
+    
     ap.arg("--centerpoint", &tool.centerpoint)
       .help("Use centerpoint for symmetry");
     
     ap.arg("--symmetrygrid", &tool.symmetrygrid)
       .help("Use symmetry grid for symmetry");
     
+    ap.arg("--thirds", &tool.thirds)
+      .help("Use rule of thirds grid for symmetry");
+    
+    ap.arg("--phigrid", &tool.phigrid)
+      .help("Use golden ratio phi grid for symmetry");
+    
+    ap.arg("--goldenspiral", &tool.goldenspiral)
+      .help("Use golden spiral for symmetry");
+    
+    ap.arg("--harmonic", &tool.harmonic)
+      .help("Use harmonic armature for symmetry");
+    
+    ap.arg("--safeareas", &tool.safeareas)
+      .help("Use action and title safe areas for symmetry");
+    
     ap.arg("--label", &tool.label)
       .help("Use label for symmetry");
        
@@ -305,11 +2116,50 @@ main( int argc, const char * argv[])
       .help("Set size (default: 1024, 1024)")
       .action(set_size);
     
+    ap.arg("--style %s:STYLE")
+      .help("Set style of primitive class as color, opacity, thickness and dash, e.g diagonals=1,0,0,0.5,thickness=1")
+      .action(set_style);
+    
+    ap.arg("--stmap %s:STMAP", &tool.stmap)
+      .help("Set st map to warp geometry into distorted space, e.g distort.exr");
+    
+    ap.arg("--sequence %s:SEQUENCE")
+      .help("Set sequence frame range, e.g 1-48")
+      .action(set_sequence);
+    
+    ap.arg("--keyframe %s:KEYFRAME")
+      .help("Add sequence keyframe for aspectratio, scale or color, e.g 48:scale=1.0")
+      .action(set_keyframe);
+    
     ap.separator("Output flags:");
     ap.arg("--outputfile %s:OUTPUTFILE")
       .help("Set output file")
       .action(set_outputfile);
     
+    ap.arg("--format %s:FORMAT", &tool.format)
+      .help("Set output format when output file is - for stdout, e.g png or exr");
+    
+    ap.arg("--datatype %s:DATATYPE")
+      .help("Set output datatype uint8, uint16, half or float (default: by output format)")
+      .action(set_datatype);
+    
+    ap.arg("--compression %s:COMPRESSION")
+      .help("Set png compression level 0-9, lower is faster (default: 6)")
+      .action(set_compression);
+    
+    ap.arg("--monochrome", &tool.monochrome)
+      .help("Write monochrome overlay as indexed png or 1-bit tiff");
+    
+    ap.arg("--tiled", &tool.tiled)
+      .help("Write tiled output, empty tiles are written as zero tiles (exr, tiff)");
+    
+    ap.arg("--tilesize %s:TILESIZE")
+      .help("Set tile size for tiled output (default: 64)")
+      .action(set_tilesize);
+    
+    ap.arg("--mmap", &tool.mmap)
+      .help("Render directly into memory mapped output file (tiff, raw, ppm)");
+    
     // clang-format on
     if (ap.parse_args(argc, (const char**)argv) < 0) {
         std::cerr << "error: " << ap.geterror() << std::endl;
@@ -317,12 +2167,55 @@ main( int argc, const char * argv[])
         ap.abort();
         return EXIT_FAILURE;
     }
+    // actions print their own errors, argparse ignores what they return
+    if (tool.code != EXIT_SUCCESS) {
+        ap.abort();
+        return tool.code;
+    }
+    parsespan.reset();
+    tracewriter.filename = tool.trace;
     if (ap["help"].get<int>()) {
         print_help(ap);
         ap.abort();
         return EXIT_SUCCESS;
     }
     
+    // crashes dump a stack trace when debugging, installing the handler
+    // resolves symbols and is deferred until asked for
+    if (tool.debug) {
+        Sysutil::setup_crash_stacktrace("stdout");
+    }
+    
+    // job file, jobs share one scheduler with its own worker threads and
+    // OIIO threading disabled so cores are not oversubscribed
+    if (tool.jobfile.size()) {
+        *printstream << "symmetrytool -- a utility for creating symmetry images" << std::endl;
+        
+        std::vector<std::unique_ptr<SymmetryJob>> jobs;
+        if (!jobsByFile(ap, tool.jobfile, jobs)) {
+            return EXIT_FAILURE;
+        }
+        print_info("Rendering job file: ", tool.jobfile);
+        OIIO::attribute("threads", 1);
+        Timer timer;
+        SymmetryScheduler scheduler(jobs, std::max(1u, std::thread::hardware_concurrency()));
+        scheduler.run();
+        
+        size_t failed = std::count_if(jobs.begin(), jobs.end(), [](const std::unique_ptr<SymmetryJob>& job) {
+            return !job->written;
+        });
+        if (tool.verbose) {
+            print_info("Jobs rendered: ", jobs.size() - failed);
+            print_info("Elapsed seconds: ", timer());
+        }
+        bool within = statsBy(tool, startup());
+        if (failed) {
+            print_error("jobs failed: ", failed);
+            return EXIT_FAILURE;
+        }
+        return within ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    
     if (!tool.outputfile.size()) {
         std::cerr << "error: must have output file parameter\n";
         ap.briefusage();
@@ -334,276 +2227,176 @@ main( int argc, const char * argv[])
         std::cout << "\nFor detailed help: symmetrytool --help\n";
         return EXIT_FAILURE;
     }
+    
+    // output file - streams the encoded image to stdout, format is used
+    // to select the writer
+    std::string outputname = tool.outputfile;
+    if (tool.outputfile == "-") {
+        if (!tool.format.size()) {
+            std::cerr << "error: must have format parameter when writing to stdout\n";
+            ap.briefusage();
+            ap.abort();
+            return EXIT_FAILURE;
+        }
+        outputname = "stdout." + Strutil::lower(tool.format);
+        printstream = &std::cerr;
+    }
+    if (tool.sequence && (tool.outputfile == "-" || tool.outputfile.find('#') == std::string::npos)) {
+        std::cerr << "error: sequence output file must have a #### frame pattern\n";
+        ap.briefusage();
+        ap.abort();
+        return EXIT_FAILURE;
+    }
+    if (tool.stmap.size() && !stmapBy(tool.stmap)) {
+        print_error("could not read st map: ", tool.stmap);
+        ap.abort();
+        return EXIT_FAILURE;
+    }
+    std::string error;
+    if (tool.monochrome && !validMonochrome(tool, error)) {
+        print_error(error, "");
+        ap.abort();
+        return EXIT_FAILURE;
+    }
 
     // symmetry program
-    std::cout << "symmetrytool -- a utility for creating symmetry images" << std::endl;
+    *printstream << "symmetrytool -- a utility for creating symmetry images" << std::endl;
 
     print_info("Writing symmetry file: ", tool.outputfile);
-    ImageSpec spec(tool.size.x, tool.size.y, 4, TypeDesc::FLOAT);
-    ImageBuf imagebuf(spec);
+    if (tool.verbose) {
+        print_info("Startup seconds: ", startup());
+    }
     
-    // symmetry
-    ROI roi(0, tool.size.x, 0, tool.size.y);
-
-    renderBoxByThickness(
-        imagebuf,
-        roi,
-        tool.color,
-        2
-    );
-    
-    // aspect ratio
-    ROI arroi = scaleBy(aspectRatioBy(roi, tool.aspectratio), tool.scale, tool.scale);
-    renderBoxByThickness(
-        imagebuf,
-        arroi,
-        tool.color,
-        2
-    );
-    
-    // center point
-    if (tool.centerpoint) {
-        
-        Imath::Vec2<float> center(
-            (arroi.xbegin + arroi.xend) / 2,
-            (arroi.ybegin + arroi.yend) / 2
-        );
-        int cross = 0;
-        if (arroi.width() > arroi.height()) {
-            cross = arroi.width() * 0.05;
+    // small charts render on the calling thread, starting the worker pool
+    // costs more than the chart itself
+    if ((int64_t)tool.size.x * tool.size.y <= smallchart && !tool.sequence) {
+        OIIO::attribute("threads", 1);
+    }
+    
+    // render directly in the output datatype, the render kernels are
+    // specialized per pixel type and no float conversion pass is needed
+    TypeDesc datatype = tool.datatype;
+    if (datatype == TypeDesc::UNKNOWN) {
+        datatype = typeByFilename(outputname);
+    }
+    if (tool.verbose) {
+        print_info("Rendering datatype: ", datatype);
+    }
+    if (tool.mmap && !isMapped(tool, outputname, datatype)) {
+        print_warning("output can not be memory mapped, writing by format: ", outputname);
+    }
+    
+    // transient structures of the chart are allocated from an arena
+    Arena arena;
+    ArenaScope scope(&arena);
+    
+    // overlay on input image
+    if (tool.inputfile.size()) {
+        if (!validOverlay(tool, error)) {
+            print_error(error, "");
+            return EXIT_FAILURE;
+        }
+        print_info("Reading input file: ", tool.inputfile);
+        bool written = overlaySymmetry(tool);
+        bool within = statsBy(tool, startup());
+        return written && within ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    
+    // single image
+    if (!tool.sequence) {
+        MappedFile mapped;
+        std::unique_ptr<ImageBuf> imagebuf;
+        bool mask = isMask(outputname);
+        bool inplace = !mask && isMapped(tool, outputname, datatype);
+        if (mask) {
+            if (tool.verbose) {
+                print_info("Rendering coverage mask: ", outputname);
+            }
+        } else if (inplace) {
+            imagebuf = imageBufByMapped(mapped, outputname, tool, datatype);
+            if (!imagebuf) {
+                return EXIT_FAILURE;
+            }
+            if (tool.verbose) {
+                print_info("Rendering into mapped file: ", outputname);
+            }
         } else {
-            cross = arroi.height() * 0.05;
+            ImageSpec spec(tool.size.x, tool.size.y, 4, datatype);
+            spec.attribute("png:compressionLevel", tool.compression);
+            imagebuf.reset(new ImageBuf(spec));
         }
         
-        int xbegin = center.x - (cross / 2);
-        int xend = xbegin + cross - 1;
-        ImageBufAlgo::render_line(
-            imagebuf,
-            xbegin,
-            center.y,
-            xend,
-            center.y,
-            { tool.color.x, tool.color.y, tool.color.z, 1.0f }
-        );
-        
-        int ybegin = center.y - (cross / 2);
-        int yend = ybegin + cross - 1;
-        ImageBufAlgo::render_line(
-            imagebuf,
-            center.x,
-            ybegin,
-            center.x,
-            yend,
-            { tool.color.x, tool.color.y, tool.color.z, 1.0f }
-        );
-    }
-    
-    // symmetry grid
-    if (tool.symmetrygrid) {
+        Timer phase;
+        DisplayList displaylist = displayListBy(tool);
+        double geometry = phase.lap();
+        std::vector<uint64_t> hashes;
+        if (imagebuf && tool.hash) {
+            renderByBands(*imagebuf, displaylist, hashes);
+        } else if (imagebuf) {
+            renderDisplayList(*imagebuf, displaylist);
+        }
+        double raster = phase.lap();
         
-        // baroque diagonal
-        ImageBufAlgo::render_line(
-            imagebuf,
-            arroi.xbegin,
-            arroi.yend - 1,
-            arroi.xend - 1,
-            arroi.ybegin,
-            { tool.color.x, tool.color.y, tool.color.z, 1.0f }
-        );
+        // pick
+        if (tool.pick) {
+            SpatialIndex spatialindex(displaylist);
+            float distance = 0.0f;
+            int nearest = spatialindex.nearest(tool.pickpoint, std::max(tool.size.x, tool.size.y), &distance);
+            if (nearest >= 0) {
+                const Primitive& primitive = displaylist[nearest];
+                print_info("Pick primitive: ", nearest);
+                print_info("Pick begin: ", Strutil::sprintf("%g, %g", primitive.begin.x, primitive.begin.y));
+                print_info("Pick end: ", Strutil::sprintf("%g, %g", primitive.end.x, primitive.end.y));
+                print_info("Pick distance: ", distance);
+            } else {
+                print_warning("no primitive to pick at: ", Strutil::sprintf("%g, %g", tool.pickpoint.x, tool.pickpoint.y));
+            }
+        }
         
-        // diagonals
-        {
-            ROI diagonal(
-                arroi.xbegin,
-                arroi.xend - 1,
-                arroi.ybegin,
-                arroi.yend - 1
-            );
-
-            ImageBufAlgo::render_line(
-                imagebuf,
-                diagonal.xbegin,
-                diagonal.ybegin,
-                diagonal.xend,
-                diagonal.yend,
-                { tool.color.x, tool.color.y, tool.color.z, 1.0f }
-            );
-            
-            // reciprocals
-            {
-                Imath::Vec2<float> d(
-                    arroi.xend - arroi.xbegin - 1,
-                    arroi.yend - arroi.ybegin - 1
-                );
-                float angle = radiansBy90() - std::atan(d.x / d.y);
-                float length = d.y * std::tan(angle);
-                float hypo = d.y * std::cos(angle);
-                Imath::Vec2<float> cross(
-                    hypo * std::sin(angle),
-                    hypo * std::cos(angle)
-                );
-                                    
-                // diagonals
-                {
-                    ImageBufAlgo::render_line(
-                        imagebuf,
-                        arroi.xbegin,
-                        arroi.ybegin,
-                        arroi.xbegin + length,
-                        arroi.yend,
-                        { tool.color.x, tool.color.y, tool.color.z, 1.0f }
-                    );
-                    
-                    ImageBufAlgo::render_line(
-                        imagebuf,
-                        arroi.xbegin,
-                        arroi.yend,
-                        arroi.xbegin + length,
-                        arroi.ybegin,
-                        { tool.color.x, tool.color.y, tool.color.z, 1.0f }
-                    );
-                    
-                    ImageBufAlgo::render_line(
-                        imagebuf,
-                        arroi.xend,
-                        arroi.ybegin,
-                        arroi.xend - length,
-                        arroi.yend,
-                        { tool.color.x, tool.color.y, tool.color.z, 1.0f }
-                    );
-                    
-                    ImageBufAlgo::render_line(
-                        imagebuf,
-                        arroi.xend,
-                        arroi.yend,
-                        arroi.xend - length,
-                        arroi.ybegin,
-                        { tool.color.x, tool.color.y, tool.color.z, 1.0f }
-                    );
-                }
-                
-                // rectangles
-                {
-                    ImageBufAlgo::render_line(
-                        imagebuf,
-                        arroi.xbegin + cross.x,
-                        arroi.ybegin,
-                        arroi.xbegin + cross.x,
-                        arroi.yend,
-                        { tool.color.x, tool.color.y, tool.color.z, 1.0f }
-                    );
-                    
-                    ImageBufAlgo::render_line(
-                        imagebuf,
-                        arroi.xend - cross.x,
-                        arroi.ybegin,
-                        arroi.xend - cross.x,
-                        arroi.yend,
-                        { tool.color.x, tool.color.y, tool.color.z, 1.0f }
-                    );
-                    
-                    ImageBufAlgo::render_line(
-                        imagebuf,
-                        arroi.xbegin,
-                        arroi.yend - cross.y,
-                        arroi.xend,
-                        arroi.yend - cross.y,
-                        { tool.color.x, tool.color.y, tool.color.z, 1.0f }
-                    );
-                    
-                    ImageBufAlgo::render_line(
-                        imagebuf,
-                        arroi.xbegin,
-                        arroi.ybegin + cross.y,
-                        arroi.xend,
-                        arroi.ybegin + cross.y,
-                        { tool.color.x, tool.color.y, tool.color.z, 1.0f }
-                    );
-                }
-                
-                // centers
-                {
-                    renderLineByPattern(
-                        imagebuf,
-                        ROI(
-                            arroi.xbegin + length,
-                            arroi.xbegin + length,
-                            arroi.ybegin,
-                            arroi.yend
-                        ),
-                        tool.color,
-                        5
-                    );
-                    
-                    renderLineByPattern(
-                        imagebuf,
-                        ROI(
-                            arroi.xend - length,
-                            arroi.xend - length,
-                            arroi.ybegin,
-                            arroi.yend
-                        ),
-                        tool.color,
-                        5
-                    );
-                }
+        // encode, masks are rasterized and hashed while written. the sidecar
+        // is written once the image is, a failed write leaves no hash
+        phase.lap();
+        bool written = true;
+        uint64_t hash = 0;
+        if (imagebuf && tool.hash) {
+            const ImageSpec& spec = imagebuf->spec();
+            hash = hashByBands(hashes, spec.width, spec.height, spec.nchannels, (int)spec.format.size());
+        }
+        if (mask) {
+            written &= writeByMask(displaylist, outputname, tool);
+        } else if (inplace) {
+            imagebuf.reset();
+            written &= closeByMapped(mapped);
+        } else {
+            // stdout writers encode to memory, except png which is streamed
+            Filesystem::IOVecOutput vecout;
+            Filesystem::IOProxy* ioproxy = nullptr;
+            if (tool.outputfile == "-") {
+                ioproxy = &vecout;
+            }
+            written &= writeSymmetry(*imagebuf, outputname, ioproxy, tool, coverageByTiles(displaylist, tool));
+            if (vecout.buffer().size()) {
+                std::cout.write((const char*)vecout.buffer().data(), vecout.buffer().size());
             }
         }
-    }
-    
-    // label
-    if (tool.label) {
-        // symmetry
-        {
-            std::ostringstream oss;
-            oss << "size: "
-                << tool.size.x
-                << ", "
-                << tool.size.y
-                << " "
-                << "aspect ratio: "
-                << tool.aspectratio;
-
-            ImageBufAlgo::render_text(
-                imagebuf,
-                roi.xbegin + roi.width() * 0.01,
-                roi.yend - roi.width() * 0.01,
-                oss.str(),
-                12,
-                "../Roboto.ttf",
-                { tool.color.x, tool.color.y, tool.color.z, 1.0f },
-                ImageBufAlgo::TextAlignX::Left,
-                ImageBufAlgo::TextAlignY::Baseline
-            );
+        std::cout.flush();
+        if (written && imagebuf && tool.hash) {
+            written = writeHash(outputname, hash, tool);
+        } else if (!written) {
+            removeHash(outputname, tool);
         }
-        
-        // aspect ratio
-        {
-            std::ostringstream oss;
-            oss << "size: "
-                << arroi.width()
-                << ", "
-                << arroi.height()
-                << " "
-                << "scale: "
-                << tool.scale;
-
-            ImageBufAlgo::render_text(
-                imagebuf,
-                arroi.xbegin + arroi.width() * 0.01,
-                arroi.yend + arroi.width() * 0.01,
-                oss.str(),
-                12,
-                "../Roboto.ttf",
-                { tool.color.x, tool.color.y, tool.color.z, 1.0f },
-                ImageBufAlgo::TextAlignX::Left,
-                ImageBufAlgo::TextAlignY::Top
-            );
+        double encode = phase.lap();
+        if (tool.stats) {
+            print_info("Stats geometry seconds: ", geometry);
+            print_info("Stats raster seconds: ", raster);
+            print_info("Stats encode seconds: ", encode);
         }
+        bool within = statsBy(tool, startup());
+        return written && within ? EXIT_SUCCESS : EXIT_FAILURE;
     }
     
-    if (!imagebuf.write(tool.outputfile)) {
-        print_error("could not write output file", imagebuf.geterror());
-    }
-    return 0;
+    // sequence
+    bool written = renderSequence(tool, datatype);
+    bool within = statsBy(tool, startup());
+    return written && within ? EXIT_SUCCESS : EXIT_FAILURE;
 }
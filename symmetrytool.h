@@ -0,0 +1,76 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2023 - present Mikael Sundell.
+//
+
+#pragma once
+
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// imath
+#include <Imath/ImathVec.h>
+
+// openimageio
+#include <OpenImageIO/typedesc.h>
+
+// symmetry style, unset values keep the defaults of the primitive class
+struct SymmetryStyle
+{
+    bool hascolor = false;
+    Imath::Vec3<float> color = Imath::Vec3<float>(1.0f, 1.0f, 1.0f);
+    float opacity = 1.0f;
+    int thickness = 0;
+    int dash = -1;
+};
+
+// symmetry tool
+struct SymmetryTool
+{
+    bool help = false;
+    bool verbose = false;
+    std::string inputfile;
+    std::string outputfile;
+    std::string format;
+    std::string jobfile;
+    std::string trace;
+    float aspectratio = 1.5f;
+    std::vector<float> aspectratios;
+    float scale = 0.5f;
+    Imath::Vec3<float> color = Imath::Vec3<float>(1.0f, 1.0f, 1.0f);
+    std::vector<Imath::Vec3<float>> colors;
+    Imath::Vec2<int> size = Imath::Vec2<int>(1024, 1024);
+    OIIO::TypeDesc datatype = OIIO::TypeDesc::UNKNOWN;
+    bool centerpoint = false;
+    bool symmetrygrid = false;
+    bool thirds = false;
+    bool phigrid = false;
+    bool goldenspiral = false;
+    bool harmonic = false;
+    bool safeareas = false;
+    bool label = false;
+    bool tiled = false;
+    int tilesize = 64;
+    bool mmap = false;
+    int compression = 6;
+    bool monochrome = false;
+    bool sequence = false;
+    Imath::Vec2<int> frames = Imath::Vec2<int>(1, 1);
+    std::vector<std::pair<int, float>> aspectratiokeys;
+    std::vector<std::pair<int, float>> scalekeys;
+    std::vector<std::pair<int, Imath::Vec3<float>>> colorkeys;
+    std::map<std::string, SymmetryStyle> styles;
+    std::string stmap;
+    std::string font;
+    bool pick = false;
+    Imath::Vec2<float> pickpoint = Imath::Vec2<float>(0.0f, 0.0f);
+    bool hash = false;
+    bool stats = false;
+    Imath::Vec2<float> budget = Imath::Vec2<float>(0.0f, 0.0f);
+    bool debug;
+    int code = EXIT_SUCCESS;
+};
+
@@ -0,0 +1,144 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2023 - present Mikael Sundell.
+//
+
+// c api test, linked against the symmetry library as an embedding
+// application would be
+
+#include "symmetry.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures = 0;
+
+static void
+check(int condition, const char* message)
+{
+    if (!condition) {
+        fprintf(stderr, "error: %s\n", message);
+        failures++;
+    }
+}
+
+// utils -- render
+static void
+test_stride(symmetry_format format, size_t size, const char* name)
+{
+    // the same chart rendered top down with a positive stride and bottom up
+    // with a negative stride from the last row has its rows flipped
+    enum { width = 64, height = 48, channels = 4 };
+    symmetry_options options;
+    symmetry_options_init(&options);
+    options.width = width;
+    options.height = height;
+    options.channels = channels;
+    options.symmetrygrid = 1;
+    options.centerpoint = 1;
+
+    ptrdiff_t stride = (ptrdiff_t)(width * channels * size);
+    unsigned char* topdown = (unsigned char*)calloc(height, stride);
+    unsigned char* bottomup = (unsigned char*)calloc(height, stride);
+    char message[256];
+    check(symmetry_render(&options, topdown, stride, format) == 0, symmetry_error());
+    check(symmetry_render(&options, bottomup + (height - 1) * stride, -stride, format) == 0, symmetry_error());
+
+    int covered = 0;
+    for (size_t i = 0; i < (size_t)(height * stride); i++) {
+        covered |= topdown[i] != 0;
+    }
+    snprintf(message, sizeof(message), "%s chart is empty", name);
+    check(covered, message);
+    for (int y = 0; y < height; y++) {
+        if (memcmp(topdown + y * stride, bottomup + (height - 1 - y) * stride, stride)) {
+            snprintf(message, sizeof(message), "%s row %d differs between positive and negative stride", name, y);
+            check(0, message);
+            break;
+        }
+    }
+    free(topdown);
+    free(bottomup);
+}
+
+static void
+test_label(void)
+{
+    // the font is found next to the library, not in the working directory
+    static unsigned char pixels[128 * 128 * 4];
+    symmetry_options options;
+    symmetry_options_init(&options);
+    options.width = 128;
+    options.height = 128;
+    options.label = 1;
+    check(symmetry_render(&options, pixels, 128 * 4, SYMMETRY_UINT8) == 0, symmetry_error());
+}
+
+// utils -- index
+static void
+test_index(void)
+{
+    symmetry_options options;
+    symmetry_options_init(&options);
+    options.width = 256;
+    options.height = 256;
+    options.aspectratio = 1.0f;
+    options.centerpoint = 1;
+    options.symmetrygrid = 1;
+
+    symmetry_index* index = symmetry_index_create(&options);
+    check(index != NULL, symmetry_error());
+    if (!index) {
+        return;
+    }
+
+    // centerpoint and diagonals cross the center of the chart
+    float distance = -1.0f;
+    int nearest = symmetry_nearest(index, 128.0f, 128.0f, 4.0f, &distance);
+    check(nearest >= 0, "no primitive nearest to the center");
+    check(distance >= 0.0f && distance <= 2.0f, "nearest distance out of range");
+
+    // the nearest primitive crosses a box around the point grown by its distance
+    int primitives[64];
+    float r = distance + 1.0f;
+    int count = symmetry_query(index, 128.0f - r, 128.0f - r, 128.0f + r, 128.0f + r, primitives, 64);
+    int found = 0;
+    for (int i = 0; i < count && i < 64; i++) {
+        found |= primitives[i] == nearest;
+    }
+    check(found, "nearest primitive not returned by query");
+
+    // all primitives in rendering order, the count is returned beyond capacity
+    int total = symmetry_query(index, 0.0f, 0.0f, 256.0f, 256.0f, NULL, 0);
+    check(total >= count && total > 0, "query of the chart returned too few primitives");
+    check(symmetry_query(index, 0.0f, 0.0f, 256.0f, 256.0f, primitives, 1) == total, "query count depends on capacity");
+    int* all = (int*)malloc(sizeof(int) * (total > 0 ? total : 1));
+    symmetry_query(index, 0.0f, 0.0f, 256.0f, 256.0f, all, total);
+    for (int i = 1; i < total; i++) {
+        check(all[i - 1] < all[i], "query primitives not in rendering order");
+    }
+    free(all);
+
+    // nothing outside of the chart
+    check(symmetry_nearest(index, -1000.0f, -1000.0f, 1.0f, NULL) == -1, "nearest primitive outside of the chart");
+    check(symmetry_query(index, -1000.0f, -1000.0f, -900.0f, -900.0f, NULL, 0) == 0, "query primitives outside of the chart");
+    symmetry_index_free(index);
+
+    options.width = 0;
+    check(symmetry_index_create(&options) == NULL && symmetry_error()[0], "index of an empty chart");
+}
+
+int
+main(void)
+{
+    test_stride(SYMMETRY_UINT8, sizeof(unsigned char), "uint8");
+    test_stride(SYMMETRY_FLOAT, sizeof(float), "float");
+    test_label();
+    test_index();
+    if (failures) {
+        fprintf(stderr, "error: %d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,49 @@
+# Copyright 2023-present Contributors to the symmetrytool project.
+# SPDX-License-Identifier: BSD-3-Clause
+# https://github.com/mikaelsundell/symmetrytool
+
+# runs one symmetrytool case with --hash and --budget and compares the hash
+# sidecar with the golden hash of the case, UPDATE writes the golden instead.
+# ENCODED cases compare the sha256 of the written file so the encoder is
+# tested, not only the rendered pixels. arguments are separated by | so
+# values may hold commas
+string (REPLACE "|" ";" args "${ARGS}")
+execute_process (
+    COMMAND ${SYMMETRYTOOL} ${args} --hash --budget ${BUDGET} --outputfile ${OUTPUT}
+    RESULT_VARIABLE result
+    OUTPUT_VARIABLE output
+    ERROR_VARIABLE error
+)
+if (NOT result EQUAL 0)
+    message (FATAL_ERROR "${NAME}: symmetrytool failed with ${result}\n${output}${error}")
+endif ()
+
+# sequences are compared by the hash of one frame
+if (NOT HASHFILE)
+    set (HASHFILE "${OUTPUT}.hash")
+endif ()
+if (NOT EXISTS "${HASHFILE}")
+    message (FATAL_ERROR "${NAME}: no hash sidecar written: ${HASHFILE}")
+endif ()
+file (READ "${HASHFILE}" sidecar)
+string (REGEX MATCH "^[0-9a-f]+" hash "${sidecar}")
+if (ENCODED)
+    file (SHA256 "${OUTPUT}" hash)
+endif ()
+
+set (golden "${GOLDEN}/${NAME}.hash")
+if (UPDATE)
+    file (WRITE "${golden}" "${hash}\n")
+    message (STATUS "${NAME}: golden hash written: ${hash}")
+    return ()
+endif ()
+
+# cases without a golden hash are reported as skipped
+if (NOT EXISTS "${golden}")
+    message (FATAL_ERROR "${NAME}: no golden hash, configure with -DSYMMETRYTOOL_UPDATE_GOLDEN=ON and run ctest to write ${golden}")
+endif ()
+file (READ "${golden}" expected)
+string (STRIP "${expected}" expected)
+if (NOT hash STREQUAL expected)
+    message (FATAL_ERROR "${NAME}: hash ${hash} does not match golden ${expected}")
+endif ()
@@ -0,0 +1,115 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2023 - present Mikael Sundell.
+//
+
+#include "trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+struct TraceEvent
+{
+    const char* name;
+    const char* category;
+    int64_t begin;
+    int64_t duration;
+};
+
+// events are appended to a buffer per thread without locking, buffers are
+// registered once per thread and kept until the trace is written
+struct TraceThread
+{
+    int id;
+    std::vector<TraceEvent> events;
+};
+
+std::atomic<bool> enabled { false };
+std::mutex mutex;
+std::vector<std::shared_ptr<TraceThread>> threads;
+const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+int64_t microseconds()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+TraceThread& traceThread()
+{
+    thread_local std::shared_ptr<TraceThread> thread;
+    if (!thread) {
+        thread = std::make_shared<TraceThread>();
+        std::lock_guard<std::mutex> lock(mutex);
+        thread->id = (int)threads.size() + 1;
+        threads.push_back(thread);
+    }
+    return *thread;
+}
+
+}
+
+void enableTrace()
+{
+    enabled.store(true, std::memory_order_relaxed);
+}
+
+bool isTraced()
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+bool writeTrace(const std::string& filename, std::string& error)
+{
+    std::ofstream os(filename);
+    if (!os) {
+        error = "could not open trace file: " + filename;
+        return false;
+    }
+    
+    // spans are complete events, threads are named by their order of
+    // first span, the main thread first
+    std::lock_guard<std::mutex> lock(mutex);
+    os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    for (const std::shared_ptr<TraceThread>& thread : threads) {
+        os << (first ? "" : ",\n")
+           << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread->id
+           << ",\"args\":{\"name\":\"" << (thread->id == 1 ? "main" : "worker " + std::to_string(thread->id - 1)) << "\"}}";
+        first = false;
+        for (const TraceEvent& event : thread->events) {
+            os << ",\n{\"name\":\"" << event.name
+               << "\",\"cat\":\"" << event.category
+               << "\",\"ph\":\"X\",\"ts\":" << event.begin
+               << ",\"dur\":" << event.duration
+               << ",\"pid\":1,\"tid\":" << thread->id << "}";
+        }
+    }
+    os << "\n]}\n";
+    if (!os) {
+        error = "could not write trace file: " + filename;
+        return false;
+    }
+    return true;
+}
+
+TraceSpan::TraceSpan(const char* name, const char* category)
+: name(name)
+, category(category)
+{
+    if (enabled.load(std::memory_order_relaxed)) {
+        begin = microseconds();
+    }
+}
+
+TraceSpan::~TraceSpan()
+{
+    if (begin >= 0) {
+        traceThread().events.push_back({ name, category, begin, microseconds() - begin });
+    }
+}
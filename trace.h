@@ -0,0 +1,35 @@
+//
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2023 - present Mikael Sundell.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// starts recording spans, spans before are not recorded
+void enableTrace();
+
+// returns true if spans are recorded
+bool isTraced();
+
+// writes recorded spans as chrome trace event json, loads in perfetto and
+// chrome://tracing with one track per thread
+bool writeTrace(const std::string& filename, std::string& error);
+
+// scoped span from construction to destruction, names and categories must
+// be string literals. costs one relaxed load when tracing is not enabled.
+class TraceSpan
+{
+public:
+    explicit TraceSpan(const char* name, const char* category = "symmetry");
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+    ~TraceSpan();
+
+private:
+    const char* name;
+    const char* category;
+    int64_t begin = -1;
+};